@@ -0,0 +1,275 @@
+#include <GaiaSharedPicture/GaiaSharedPicture.hpp>
+#include <GaiaSharedPicture/PictureCopier.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace Gaia::SharedPicture;
+
+/// Name of the shared memory block used by the benchmark.
+constexpr const char* BlockName = "gaia_shared_picture_benchmark";
+/// Interval between pictures written in the latency phase, long enough for the reader to fall asleep.
+constexpr std::chrono::microseconds LatencyInterval {2000};
+/// Max time the reader waits for a picture before giving up.
+constexpr std::chrono::microseconds ReaderTimeout {1000000};
+
+/// Statistics of one benchmark case.
+struct CaseResult
+{
+    int Width;
+    int Height;
+    int Depth;
+    int Channels;
+    std::size_t Bytes;
+    std::vector<std::int64_t> WriteCosts;
+    std::vector<std::int64_t> Latencies;
+    std::uint64_t ReceivedFrames;
+    double FramesPerSecond;
+};
+
+/// Get the time stamp in nanoseconds of the monotonic clock, which is shared by all processes.
+std::int64_t GetTimeStamp()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Get the value at the given percentile of the sorted values.
+double GetPercentile(const std::vector<std::int64_t>& sorted_values, double percentile)
+{
+    if (sorted_values.empty()) return 0.0;
+    auto index = std::min(sorted_values.size() - 1,
+                          static_cast<std::size_t>(percentile * static_cast<double>(sorted_values.size())));
+    return static_cast<double>(sorted_values[index]);
+}
+
+/// Write all bytes into the file descriptor.
+void WriteAll(int descriptor, const void* data, std::size_t size)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    while (size > 0)
+    {
+        auto written = ::write(descriptor, bytes, size);
+        if (written <= 0) throw std::runtime_error("Failed to write into the pipe.");
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+/// Read all bytes from the file descriptor.
+void ReadAll(int descriptor, void* data, std::size_t size)
+{
+    auto* bytes = static_cast<unsigned char*>(data);
+    while (size > 0)
+    {
+        auto received = ::read(descriptor, bytes, size);
+        if (received <= 0) throw std::runtime_error("Failed to read from the pipe.");
+        bytes += received;
+        size -= static_cast<std::size_t>(received);
+    }
+}
+
+/**
+ * @brief Reader process, receives pictures and measures the latency from publication to wake up.
+ * @param frames Count of pictures written in each phase.
+ * @param pipe_descriptor Write end of the pipe to the writer process.
+ * @details
+ *  The publication time stamp is embedded in the first bytes of every picture.
+ *  Latencies of the latency phase and the count of pictures received in total are sent back through the pipe.
+ */
+void RunReader(int frames, int pipe_descriptor)
+{
+    PictureReader reader(BlockName);
+    char ready = 1;
+    WriteAll(pipe_descriptor, &ready, sizeof(ready));
+
+    std::vector<std::int64_t> latencies;
+    std::uint64_t received = 0;
+    while (reader.GetLastSequence() < static_cast<std::uint64_t>(frames) * 2)
+    {
+        auto picture = reader.WaitNext(ReaderTimeout);
+        auto now = GetTimeStamp();
+        if (picture.empty()) break;
+        ++received;
+        if (reader.GetLastSequence() > static_cast<std::uint64_t>(frames)) continue;
+        std::int64_t stamp;
+        std::memcpy(&stamp, picture.data, sizeof(stamp));
+        latencies.push_back(now - stamp);
+    }
+
+    std::uint64_t count = latencies.size();
+    WriteAll(pipe_descriptor, &count, sizeof(count));
+    WriteAll(pipe_descriptor, latencies.data(), latencies.size() * sizeof(std::int64_t));
+    WriteAll(pipe_descriptor, &received, sizeof(received));
+}
+
+/// Write a picture with the publication time stamp embedded, and return the write cost in nanoseconds.
+std::int64_t WriteStamped(PictureWriter& writer, const cv::Mat& picture)
+{
+    auto begin = GetTimeStamp();
+    auto buffer = writer.AcquireWriteBuffer(picture);
+    if (buffer.empty()) throw std::runtime_error("Failed to acquire a slot, all slots are held.");
+    PictureCopier::Copy(picture, buffer);
+    auto stamp = GetTimeStamp();
+    std::memcpy(buffer.data, &stamp, sizeof(stamp));
+    writer.Commit();
+    return GetTimeStamp() - begin;
+}
+
+/**
+ * @brief Run a benchmark case with a writer in this process and a reader in a child process.
+ * @details
+ *  In the latency phase, pictures are written at a fixed interval, so the reader is asleep when a picture
+ *  is published; in the throughput phase, pictures are written back to back.
+ */
+CaseResult RunCase(int frames, cv::Size size, int depth, int channels)
+{
+    CaseResult result {size.width, size.height, depth, channels, 0, {}, {}, 0, 0.0};
+    cv::Mat picture(size, CV_MAKETYPE(depth, channels));
+    cv::randu(picture, cv::Scalar::all(0), cv::Scalar::all(255));
+    result.Bytes = picture.total() * picture.elemSize();
+
+    BlockOptions options;
+    options.Layout = BlockOptions::Layouts::Ring;
+    options.SlotCount = 4;
+    boost::interprocess::shared_memory_object::remove(BlockName);
+    PictureWriter writer(BlockName, result.Bytes, true, options);
+
+    int pipe_descriptors[2];
+    if (::pipe(pipe_descriptors) != 0) throw std::runtime_error("Failed to create a pipe.");
+    auto child = ::fork();
+    if (child < 0) throw std::runtime_error("Failed to fork the reader process.");
+    if (child == 0)
+    {
+        ::close(pipe_descriptors[0]);
+        int code = 0;
+        try
+        {
+            RunReader(frames, pipe_descriptors[1]);
+        }catch(std::exception& error)
+        {
+            std::cerr << "Reader failed: " << error.what() << std::endl;
+            code = 1;
+        }
+        // Skip destructors, the writer and the copy engine threads belong to the parent process.
+        ::_exit(code);
+    }
+    ::close(pipe_descriptors[1]);
+    char ready;
+    ReadAll(pipe_descriptors[0], &ready, sizeof(ready));
+
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        WriteStamped(writer, picture);
+        std::this_thread::sleep_for(LatencyInterval);
+    }
+    result.WriteCosts.reserve(frames);
+    auto begin = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        result.WriteCosts.push_back(WriteStamped(writer, picture));
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    result.FramesPerSecond = frames / elapsed.count();
+
+    std::uint64_t count;
+    ReadAll(pipe_descriptors[0], &count, sizeof(count));
+    result.Latencies.resize(count);
+    ReadAll(pipe_descriptors[0], result.Latencies.data(), count * sizeof(std::int64_t));
+    ReadAll(pipe_descriptors[0], &result.ReceivedFrames, sizeof(result.ReceivedFrames));
+    ::close(pipe_descriptors[0]);
+    ::waitpid(child, nullptr, 0);
+
+    writer.Release();
+    boost::interprocess::shared_memory_object::remove(BlockName);
+    return result;
+}
+
+/// Get the name of the OpenCV depth.
+const char* GetDepthName(int depth)
+{
+    switch (depth)
+    {
+        case CV_8U: return "8U";
+        case CV_16U: return "16U";
+        case CV_32F: return "32F";
+        default: return "Unknown";
+    }
+}
+
+/// Print the results as a JSON document.
+void PrintJson(std::ostream& stream, int frames, std::vector<CaseResult>& results)
+{
+    stream << "{\n  \"benchmark\": \"GaiaSharedPicture\",\n  \"frames\": " << frames << ",\n  \"cases\": [";
+    for (std::size_t index = 0; index < results.size(); ++index)
+    {
+        auto& result = results[index];
+        std::sort(result.WriteCosts.begin(), result.WriteCosts.end());
+        std::sort(result.Latencies.begin(), result.Latencies.end());
+        double total_cost = 0.0;
+        for (auto cost : result.WriteCosts) total_cost += static_cast<double>(cost);
+        auto mean_cost = result.WriteCosts.empty() ? 0.0 : total_cost / static_cast<double>(result.WriteCosts.size());
+
+        stream << (index == 0 ? "\n" : ",\n") << "    {"
+               << "\"width\": " << result.Width << ", \"height\": " << result.Height
+               << ", \"depth\": \"" << GetDepthName(result.Depth) << "\", \"channels\": " << result.Channels
+               << ", \"bytes\": " << result.Bytes
+               << ", \"write_cost_us\": {\"mean\": " << mean_cost / 1e3
+               << ", \"p50\": " << GetPercentile(result.WriteCosts, 0.5) / 1e3
+               << ", \"p99\": " << GetPercentile(result.WriteCosts, 0.99) / 1e3 << "}"
+               << ", \"latency_us\": {\"p50\": " << GetPercentile(result.Latencies, 0.5) / 1e3
+               << ", \"p99\": " << GetPercentile(result.Latencies, 0.99) / 1e3
+               << ", \"p999\": " << GetPercentile(result.Latencies, 0.999) / 1e3 << "}"
+               << ", \"latency_samples\": " << result.Latencies.size()
+               << ", \"received_frames\": " << result.ReceivedFrames
+               << ", \"frames_per_second\": " << result.FramesPerSecond
+               << ", \"bytes_per_second\": " << result.FramesPerSecond * static_cast<double>(result.Bytes)
+               << "}";
+    }
+    stream << "\n  ]\n}" << std::endl;
+}
+
+/**
+ * @brief Sweep resolutions, depths and channel counts, and print the results as JSON to the standard output.
+ * @details Usage: GaiaSharedPictureBenchmark [frames per phase, 300 by default]
+ */
+int main(int argc, char** argv)
+{
+    int frames = argc > 1 ? std::max(1, std::atoi(argv[1])) : 300;
+    const cv::Size sizes[] = {{640, 480}, {1920, 1080}, {3840, 2160}};
+    const int depths[] = {CV_8U, CV_16U, CV_32F};
+    const int channel_counts[] = {1, 3, 4};
+
+    std::vector<CaseResult> results;
+    try
+    {
+        for (const auto& size : sizes)
+        {
+            for (auto depth : depths)
+            {
+                for (auto channels : channel_counts)
+                {
+                    std::cerr << size.width << "x" << size.height << " " << GetDepthName(depth)
+                              << "C" << channels << std::endl;
+                    results.push_back(RunCase(frames, size, depth, channels));
+                }
+            }
+        }
+    }catch(std::exception& error)
+    {
+        std::cerr << "Benchmark failed: " << error.what() << std::endl;
+        boost::interprocess::shared_memory_object::remove(BlockName);
+        return 1;
+    }
+
+    PrintJson(std::cout, frames, results);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <GaiaSharedPicture/BlockLayout.hpp>
+#include <GaiaSharedPicture/HeaderCoder.hpp>
+#include <GaiaSharedPicture/PayloadCodec.hpp>
+
+namespace Gaia::SharedPicture
+{
+    /// Magic number at the beginning of every batch, "GSPB" in little endian.
+    constexpr std::uint32_t BridgeMagic = 0x42505347;
+    /// Version of the bridge protocol.
+    constexpr std::uint32_t BridgeVersion = 1;
+    /// Max count of frames in a batch, so a batch is sent with one sendmsg() within the iovec limit.
+    constexpr std::uint32_t MaxBridgeBatchSize = 256;
+
+    /**
+     * @brief Header of a batch of frames sent over the bridge connection.
+     * @details
+     *  Every frame of the batch follows the header as a BridgeFrameHeader and its payload bytes.
+     *  Integers are in the byte order of the sender, so both ends must run on the same architecture.
+     */
+    struct BridgeBatchHeader
+    {
+        /// Magic number, must be BridgeMagic.
+        std::uint32_t Magic {BridgeMagic};
+        /// Version of the protocol, must be BridgeVersion.
+        std::uint32_t Version {BridgeVersion};
+        /// Count of frames in this batch.
+        std::uint32_t FrameCount {0};
+        /// Reserved, 0.
+        std::uint32_t Reserved {0};
+    };
+
+    /// Header of a frame sent over the bridge connection, followed by its payload bytes.
+    struct BridgeFrameHeader
+    {
+        /// Sequence number of the picture in the source block.
+        std::uint64_t Sequence {0};
+        /// Bytes of the payload following this header.
+        std::uint64_t PayloadSize {0};
+        /**
+         * @brief Bytes between the beginnings of two adjacent rows of a raw payload.
+         * @details
+         *  Raw payloads are sent as they are in the source slot, from the first byte of the first row
+         *  to the last byte of the last row, so rows keep the padding of the source block.
+         */
+        std::uint64_t RowStride {0};
+        /// Codec of the payload.
+        PayloadCodecs Codec {PayloadCodecs::Raw};
+        /// Reserved, 0.
+        std::uint32_t Reserved {0};
+        /// Picture header encoded by HeaderCoder::EncodeExtended.
+        unsigned char Picture[HeaderCoder::ExtendedHeaderSize] {};
+        /// Metadata published with the picture, time stamps are in the steady clock of the sender.
+        FrameMetadata Metadata;
+    };
+}
\ No newline at end of file
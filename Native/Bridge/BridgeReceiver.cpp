@@ -0,0 +1,151 @@
+#include "BridgeReceiver.hpp"
+
+#include <GaiaSharedPicture/PictureCopier.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/socket.h>
+
+namespace Gaia::SharedPicture
+{
+    /// Construct a receiver publishing into the writer.
+    BridgeReceiver::BridgeReceiver(PictureWriter &writer, int socket, const BridgeReceiverOptions &options) :
+            Writer(writer), Socket(socket), Options(options)
+    {}
+
+    /// Receive exactly the given bytes.
+    bool BridgeReceiver::ReceiveAll(void *data, std::size_t size, bool end_allowed)
+    {
+        auto* bytes = static_cast<unsigned char*>(data);
+        std::size_t total = 0;
+        while (total < size)
+        {
+            auto received = ::recv(Socket, bytes + total, size - total, MSG_WAITALL);
+            if (received < 0)
+            {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("Failed to receive batch: ") + std::strerror(errno));
+            }
+            if (received == 0)
+            {
+                if (total == 0 && end_allowed) return false;
+                throw std::runtime_error("Failed to receive batch: the connection is closed in the middle of a batch.");
+            }
+            total += static_cast<std::size_t>(received);
+        }
+        return true;
+    }
+
+    /// Receive a frame and publish it.
+    bool BridgeReceiver::ReceiveFrame()
+    {
+        BridgeFrameHeader frame;
+        ReceiveAll(&frame, sizeof(frame));
+        PictureHeader header;
+        if (!HeaderCoder::DecodeExtended(frame.Picture, header))
+        {
+            throw std::runtime_error("Failed to receive frame, picture header decoding failed.");
+        }
+        auto row_size = HeaderCoder::GetRowSize(header);
+        auto row_count = HeaderCoder::GetRowCount(header);
+        // Sizes come from the peer, so they are bounded before any buffer is sized by them.
+        if (row_count != 0 && row_size > Options.MaxPictureSize / row_count)
+        {
+            throw std::runtime_error("Failed to receive frame, the picture is bigger than the max picture size.");
+        }
+        auto picture_size = row_size * row_count;
+        if (frame.Codec == PayloadCodecs::Raw)
+        {
+            if (frame.RowStride < row_size ||
+                (row_count > 1 && frame.RowStride > (SIZE_MAX - row_size) / (row_count - 1)))
+            {
+                throw std::runtime_error("Failed to receive frame, the row stride does not match the picture header.");
+            }
+            auto expected_size = row_count != 0 ? frame.RowStride * (row_count - 1) + row_size : 0;
+            if (frame.PayloadSize != expected_size)
+            {
+                throw std::runtime_error("Failed to receive frame, payload size does not match the picture header.");
+            }
+            if (frame.PayloadSize > Options.MaxPictureSize)
+            {
+                throw std::runtime_error("Failed to receive frame, the payload is bigger than the max picture size.");
+            }
+        }
+        else if (frame.Codec != PayloadCodecs::DeltaRle || frame.PayloadSize > picture_size)
+        {
+            throw std::runtime_error("Failed to receive frame, unknown codec or oversized encoded payload.");
+        }
+
+        if (picture_size == 0)
+        {
+            // Empty pictures can not be acquired, and their payloads are empty.
+            if (frame.PayloadSize != 0)
+            {
+                throw std::runtime_error("Failed to receive frame, an empty picture has a payload.");
+            }
+            return false;
+        }
+
+        auto destination = Writer.AcquireWriteBuffer(header);
+        if (destination.empty())
+        {
+            // All slots are held by readers, so the frame is dropped like a refused write,
+            // and no buffer is pending.
+            Scratch.resize(frame.PayloadSize);
+            ReceiveAll(Scratch.data(), Scratch.size());
+            return false;
+        }
+        try
+        {
+            if (frame.Codec == PayloadCodecs::Raw && destination.step[destination.dims - 2] == frame.RowStride)
+            {
+                ReceiveAll(destination.data, frame.PayloadSize);
+            }
+            else
+            {
+                Scratch.resize(frame.PayloadSize);
+                ReceiveAll(Scratch.data(), Scratch.size());
+                if (frame.Codec == PayloadCodecs::Raw)
+                {
+                    PictureCopier::Copy(HeaderCoder::GetPicture(header, Scratch.data(), frame.RowStride), destination);
+                }
+                else if (!PayloadCodec::Decode(Scratch.data(), Scratch.size(), destination))
+                {
+                    throw std::runtime_error("Failed to receive frame, encoded payload is broken.");
+                }
+            }
+            if (Writer.GetOptions().Layout == BlockOptions::Layouts::Ring) Writer.SetMetadata(frame.Metadata);
+        }catch(...)
+        {
+            Writer.Cancel();
+            throw;
+        }
+        Writer.Commit();
+        return true;
+    }
+
+    /// Receive a batch of frames and publish them.
+    bool BridgeReceiver::ReceiveBatch(std::size_t &published)
+    {
+        published = 0;
+        BridgeBatchHeader batch;
+        if (!ReceiveAll(&batch, sizeof(batch), true)) return false;
+        if (batch.Magic != BridgeMagic || batch.Version != BridgeVersion)
+        {
+            throw std::runtime_error("Failed to receive batch, the stream is not a bridge stream of version " +
+                                     std::to_string(BridgeVersion) + ".");
+        }
+        if (batch.FrameCount > MaxBridgeBatchSize)
+        {
+            throw std::runtime_error("Failed to receive batch, it has more frames than a sender sends.");
+        }
+        for (std::uint32_t index = 0; index < batch.FrameCount; ++index)
+        {
+            if (ReceiveFrame()) ++published;
+        }
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <GaiaSharedPicture/GaiaSharedPicture.hpp>
+
+#include "BridgeProtocol.hpp"
+
+namespace Gaia::SharedPicture
+{
+    /// Options of a bridge receiver.
+    struct BridgeReceiverOptions
+    {
+        /// Max bytes of a received picture and of its payload, bigger frames are refused before they are written.
+        std::size_t MaxPictureSize {std::size_t(256) << 20};
+    };
+
+    /**
+     * @brief Receiver publishing the frames streamed by a BridgeSender into a local writer.
+     * @details
+     *  Raw payloads whose row stride matches the acquired buffer are received straight into the slot,
+     *  other payloads are received into a scratch buffer, then copied or decoded into the slot.
+     *  Empty pictures can not be written into a ring layout block, so they are received and skipped.
+     */
+    class BridgeReceiver
+    {
+        /// Writer publishing the received pictures.
+        PictureWriter& Writer;
+        /// Connected TCP socket.
+        int Socket;
+        /// Options of this receiver.
+        BridgeReceiverOptions Options;
+        /// Scratch buffer of payloads which can not be received in place.
+        std::vector<unsigned char> Scratch;
+
+        /**
+         * @brief Receive exactly the given bytes.
+         * @retval true All bytes are received.
+         * @retval false The connection is closed before the first byte, only allowed if end_allowed is true.
+         * @throws runtime_error If the connection is broken or closed in the middle of the bytes.
+         */
+        bool ReceiveAll(void* data, std::size_t size, bool end_allowed = false);
+        /**
+         * @brief Receive a frame and publish it.
+         * @return Whether the frame is published, false if the picture is empty or all ring layout slots are held.
+         * @throws runtime_error If the frame is broken, or bigger than the max picture size.
+         */
+        bool ReceiveFrame();
+
+    public:
+        /**
+         * @brief Construct a receiver publishing into the writer.
+         * @param writer Writer of the local block, a resizable ring layout block follows the size of the pictures.
+         * @param socket Connected TCP socket, owned by the caller.
+         * @param options Options of the received frames.
+         */
+        BridgeReceiver(PictureWriter& writer, int socket,
+                       const BridgeReceiverOptions& options = BridgeReceiverOptions());
+
+        /**
+         * @brief Receive a batch of frames and publish them.
+         * @param published Count of published frames, empty pictures are skipped, and so are frames received
+         *                  while all ring layout slots are held.
+         * @retval true A batch is received.
+         * @retval false The sender has closed the connection.
+         * @throws runtime_error If the connection is broken, the stream is not a bridge stream, a picture is bigger
+         *                       than the max picture size, or it can not be written like
+         *                       PictureWriter::AcquireWriteBuffer().
+         */
+        bool ReceiveBatch(std::size_t& published);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "BridgeSender.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace Gaia::SharedPicture
+{
+    /// Construct a sender of the pictures of the reader over the socket.
+    BridgeSender::BridgeSender(PictureReader &reader, int socket, const BridgeSenderOptions &options) :
+            Reader(reader), Socket(socket), Options(options)
+    {
+        try
+        {
+            if (options.BatchSize == 0 || options.BatchSize > MaxBridgeBatchSize)
+            {
+                throw std::runtime_error("Failed to construct bridge sender, batch size must be between 1 and " +
+                                         std::to_string(MaxBridgeBatchSize) + ".");
+            }
+            int enable = 1;
+            ZeroCopy = ::setsockopt(Socket, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) == 0;
+            // Subscribe before the first picture is waited for, so no publication is missed.
+            Reader.GetReadinessDescriptor();
+        }catch(...)
+        {
+            ::close(Socket);
+            throw;
+        }
+    }
+
+    /// Wait for the sends in flight, then close the socket before the leases are released.
+    BridgeSender::~BridgeSender()
+    {
+        bool flushed = false;
+        try
+        {
+            flushed = Flush(std::chrono::milliseconds(1000));
+        }catch(std::exception&)
+        {}
+        if (!flushed)
+        {
+            // A plain shutdown keeps the queued bytes, and the kernel may still read the slots after their leases
+            // are released; a reset purges the send queue, and the peer never receives the rest of the stream.
+            linger reset {1, 0};
+            ::setsockopt(Socket, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+        }
+        ::close(Socket);
+    }
+
+    /// Max count of leases held at the same time.
+    std::size_t BridgeSender::GetMaxHeldLeases() const
+    {
+        auto slot_count = BlockLayout::GetBlockHeader(Reader.GetMemoryPointer())->SlotCount;
+        return slot_count > 3 ? slot_count - 2 : 1;
+    }
+
+    /// Wait for the next published picture until the deadline, and hold it if it is newer than the last sent.
+    ReadLease BridgeSender::WaitPicture(std::chrono::steady_clock::time_point deadline)
+    {
+        while (true)
+        {
+            // Clear before leasing, so a picture published after the lease makes the descriptor readable again.
+            Reader.ClearReadiness();
+            // Encoded pictures are leased without decoding, so they are forwarded as they are.
+            auto lease = Reader.LeaseEncoded();
+            if (lease && lease.GetSequence() > LastSequence) return lease;
+            lease.Release();
+
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) return {};
+            auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count();
+            timespec time_limit {static_cast<time_t>(wait / 1000000000), static_cast<long>(wait % 1000000000)};
+            pollfd descriptor {Reader.GetReadinessDescriptor(), POLLIN, 0};
+            if (::ppoll(&descriptor, 1, &time_limit, nullptr) < 0 && errno != EINTR)
+            {
+                throw std::runtime_error(std::string("Failed to wait for pictures: ") + std::strerror(errno));
+            }
+        }
+    }
+
+    /// Send all bytes described by the message.
+    void BridgeSender::SendMessage(msghdr &message, bool zero_copy)
+    {
+        auto flags = MSG_NOSIGNAL | (zero_copy ? MSG_ZEROCOPY : 0);
+        while (message.msg_iovlen > 0)
+        {
+            auto sent = ::sendmsg(Socket, &message, flags);
+            if (sent < 0)
+            {
+                if (errno == EINTR) continue;
+                // The locked memory limit of the socket is reached, so the rest is copied by the kernel.
+                if (errno == ENOBUFS && (flags & MSG_ZEROCOPY))
+                {
+                    flags &= ~MSG_ZEROCOPY;
+                    continue;
+                }
+                throw std::runtime_error(std::string("Failed to send batch: ") + std::strerror(errno));
+            }
+            if (flags & MSG_ZEROCOPY) ++SendCount;
+            auto remaining = static_cast<std::size_t>(sent);
+            while (message.msg_iovlen > 0 && remaining >= message.msg_iov->iov_len)
+            {
+                remaining -= message.msg_iov->iov_len;
+                ++message.msg_iov;
+                --message.msg_iovlen;
+            }
+            if (message.msg_iovlen > 0)
+            {
+                message.msg_iov->iov_base = static_cast<unsigned char*>(message.msg_iov->iov_base) + remaining;
+                message.msg_iov->iov_len -= remaining;
+            }
+        }
+    }
+
+    /// Check whether the zero copy send with the given identifier is completed.
+    bool BridgeSender::IsSendCompleted(std::uint32_t send) const
+    {
+        auto offset = static_cast<std::int32_t>(send - CompletedCount);
+        return offset < 0 || (static_cast<std::size_t>(offset) < CompletedSends.size() && CompletedSends[offset]);
+    }
+
+    /// Reap the completions of the zero copy sends and release the leases of the completed batches.
+    void BridgeSender::ReapCompletions(std::chrono::milliseconds timeout)
+    {
+        if (InFlight.empty()) return;
+        if (timeout.count() > 0)
+        {
+            // Errors, including completions, are always reported by poll() without being requested.
+            pollfd descriptor {Socket, 0, 0};
+            ::poll(&descriptor, 1, static_cast<int>(timeout.count()));
+        }
+        while (true)
+        {
+            alignas(cmsghdr) unsigned char control[128];
+            msghdr message {};
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            if (::recvmsg(Socket, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                throw std::runtime_error(std::string("Failed to reap sent batches: ") + std::strerror(errno));
+            }
+            for (auto* control_message = CMSG_FIRSTHDR(&message); control_message;
+                 control_message = CMSG_NXTHDR(&message, control_message))
+            {
+                if (!(control_message->cmsg_level == SOL_IP && control_message->cmsg_type == IP_RECVERR) &&
+                    !(control_message->cmsg_level == SOL_IPV6 && control_message->cmsg_type == IPV6_RECVERR))
+                    continue;
+                sock_extended_err error {};
+                std::memcpy(&error, CMSG_DATA(control_message), sizeof(error));
+                if (error.ee_errno != 0 || error.ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+                // Sends from ee_info to ee_data are completed, ranges are not always reported in order,
+                // such as when a retransmitted or cloned buffer is freed late.
+                for (auto send = error.ee_info; static_cast<std::int32_t>(error.ee_data - send) >= 0; ++send)
+                {
+                    auto offset = static_cast<std::int32_t>(send - CompletedCount);
+                    if (offset < 0) continue;
+                    // Identifiers of sends never made are ignored, so a broken report can not grow the bitmap.
+                    if (static_cast<std::int32_t>(send - SendCount) >= 0) break;
+                    if (static_cast<std::size_t>(offset) >= CompletedSends.size())
+                        CompletedSends.resize(static_cast<std::size_t>(offset) + 1, false);
+                    CompletedSends[offset] = true;
+                }
+                while (!CompletedSends.empty() && CompletedSends.front())
+                {
+                    CompletedSends.pop_front();
+                    ++CompletedCount;
+                }
+            }
+        }
+        // A batch is released once all of its sends are completed, wherever it is in the queue.
+        for (auto batch = InFlight.begin(); batch != InFlight.end();)
+        {
+            bool completed = true;
+            for (auto send = batch->FirstSend; completed && static_cast<std::int32_t>(batch->LastSend - send) >= 0;
+                 ++send)
+                completed = IsSendCompleted(send);
+            if (!completed)
+            {
+                ++batch;
+                continue;
+            }
+            HeldLeases -= batch->Leases.size();
+            batch = InFlight.erase(batch);
+        }
+    }
+
+    /// Wait for newly published pictures and send them as one batch.
+    std::size_t BridgeSender::SendBatch(std::chrono::microseconds timeout)
+    {
+        ReapCompletions(std::chrono::milliseconds(0));
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        auto max_held_leases = GetMaxHeldLeases();
+
+        PendingBatch batch;
+        while (batch.Leases.size() < Options.BatchSize)
+        {
+            // Slots held by sends in flight are released once the kernel no longer reads them.
+            while (HeldLeases + batch.Leases.size() >= max_held_leases && !InFlight.empty() &&
+                   std::chrono::steady_clock::now() < deadline)
+                ReapCompletions(std::chrono::milliseconds(1));
+            if (HeldLeases + batch.Leases.size() >= max_held_leases) break;
+
+            auto lease = WaitPicture(deadline);
+            if (!lease) break;
+            if (batch.Leases.empty()) deadline = std::chrono::steady_clock::now() + Options.BatchDelay;
+            LastSequence = lease.GetSequence();
+            batch.Leases.push_back(std::move(lease));
+        }
+        if (batch.Leases.empty()) return 0;
+
+        auto frame_count = batch.Leases.size();
+        batch.Batch = std::make_unique<BridgeBatchHeader>();
+        batch.Batch->FrameCount = static_cast<std::uint32_t>(frame_count);
+        batch.Headers.resize(frame_count);
+        batch.Payloads.resize(frame_count);
+        std::vector<iovec> vectors;
+        vectors.reserve(1 + frame_count * 2);
+        vectors.push_back({batch.Batch.get(), sizeof(BridgeBatchHeader)});
+        // Bytes sent straight from the leased slots.
+        std::size_t slot_bytes = 0;
+
+        for (std::size_t index = 0; index < frame_count; ++index)
+        {
+            auto& lease = batch.Leases[index];
+            auto& frame = batch.Headers[index];
+            const auto& header = lease.GetHeader();
+            frame.Sequence = lease.GetSequence();
+            HeaderCoder::EncodeExtended(header, frame.Picture);
+            if (const auto* metadata = lease.GetMetadata()) frame.Metadata = *metadata;
+            vectors.push_back({&frame, sizeof(BridgeFrameHeader)});
+            if (lease.GetCodec() != PayloadCodecs::Raw)
+            {
+                frame.Codec = lease.GetCodec();
+                frame.PayloadSize = lease.GetPayloadSize();
+                vectors.push_back({const_cast<unsigned char*>(lease.GetPayload()), frame.PayloadSize});
+                slot_bytes += frame.PayloadSize;
+                continue;
+            }
+
+            const auto& picture = lease.GetPicture();
+
+            auto row_size = HeaderCoder::GetRowSize(header);
+            auto row_count = HeaderCoder::GetRowCount(header);
+            if (Options.Codec != PayloadCodecs::Raw && row_count != 0)
+            {
+                auto& payload = batch.Payloads[index];
+                payload.resize(row_size * row_count);
+                auto encoded_size = PayloadCodec::Encode(picture, payload.data(), payload.size());
+                if (encoded_size != 0)
+                {
+                    // The encoded copy is sent instead, so the slot is released at once.
+                    lease.Release();
+                    frame.Codec = Options.Codec;
+                    frame.PayloadSize = encoded_size;
+                    vectors.push_back({payload.data(), encoded_size});
+                    continue;
+                }
+                payload.clear();
+            }
+            frame.RowStride = picture.step[picture.dims - 2];
+            frame.PayloadSize = row_count != 0 ? frame.RowStride * (row_count - 1) + row_size : 0;
+            vectors.push_back({picture.data, frame.PayloadSize});
+            slot_bytes += frame.PayloadSize;
+        }
+
+        msghdr message {};
+        message.msg_iov = vectors.data();
+        message.msg_iovlen = vectors.size();
+        auto send_count = SendCount;
+        std::exception_ptr failure;
+        try
+        {
+            SendMessage(message, ZeroCopy && slot_bytes >= Options.ZeroCopyThreshold);
+        }catch(...)
+        {
+            failure = std::current_exception();
+        }
+        // Parts sent with MSG_ZEROCOPY are read by the kernel until they complete, even if a later part has failed,
+        // so their leases are kept in flight.
+        if (SendCount != send_count)
+        {
+            batch.FirstSend = send_count;
+            batch.LastSend = SendCount - 1;
+            batch.Leases.erase(std::remove_if(batch.Leases.begin(), batch.Leases.end(),
+                                              [](const ReadLease& lease) { return !lease; }),
+                               batch.Leases.end());
+            HeldLeases += batch.Leases.size();
+            InFlight.push_back(std::move(batch));
+        }
+        if (failure) std::rethrow_exception(failure);
+        return frame_count;
+    }
+
+    /// Wait until all zero copy sends are completed and release their leases.
+    bool BridgeSender::Flush(std::chrono::milliseconds timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!InFlight.empty() && std::chrono::steady_clock::now() < deadline)
+            ReapCompletions(std::chrono::milliseconds(1));
+        return InFlight.empty();
+    }
+}
\ No newline at end of file
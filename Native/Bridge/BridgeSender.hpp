@@ -0,0 +1,139 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <GaiaSharedPicture/GaiaSharedPicture.hpp>
+#include <sys/socket.h>
+
+#include "BridgeProtocol.hpp"
+
+namespace Gaia::SharedPicture
+{
+    /// Options of a bridge sender.
+    struct BridgeSenderOptions
+    {
+        /// Max count of frames sent in one batch, up to MaxBridgeBatchSize.
+        unsigned int BatchSize {1};
+        /// Max time to wait for more frames after the first frame of a batch, 0 to send what is published.
+        std::chrono::microseconds BatchDelay {0};
+        /// Codec of the payloads, pictures which the codec does not shrink are sent raw.
+        PayloadCodecs Codec {PayloadCodecs::Raw};
+        /// Min bytes of a batch sent with MSG_ZEROCOPY, smaller batches are cheaper to copy than to pin.
+        std::size_t ZeroCopyThreshold {16384};
+    };
+
+    /**
+     * @brief Sender streaming the pictures of a ring layout block over a connected TCP socket.
+     * @details
+     *  Raw pictures, and pictures encoded by the writer, are sent straight from the slots held by read leases
+     *  with sendmsg() and MSG_ZEROCOPY, and the leases are released when the kernel reports the send as completed,
+     *  so the bytes are never copied in user space. Sockets without SO_ZEROCOPY fall back to plain sendmsg()
+     *  from the same leases.
+     *  Every held lease takes a slot, so the sender holds at most (slot count - 2) leases at the same time,
+     *  and at least one.
+     */
+    class BridgeSender
+    {
+        /// Frames sent with MSG_ZEROCOPY whose send is not completed yet.
+        struct PendingBatch
+        {
+            /// Header of the batch referred to by the send.
+            std::unique_ptr<BridgeBatchHeader> Batch;
+            /// Leases of the slots whose bytes are being sent.
+            std::vector<ReadLease> Leases;
+            /// Frame headers referred to by the send.
+            std::vector<BridgeFrameHeader> Headers;
+            /// Encoded payloads referred to by the send.
+            std::vector<std::vector<unsigned char>> Payloads;
+            /// Identifier of the first zero copy send of this batch.
+            std::uint32_t FirstSend {0};
+            /// Identifier of the last zero copy send of this batch.
+            std::uint32_t LastSend {0};
+        };
+
+        /// Reader of the streamed block.
+        PictureReader& Reader;
+        /// Connected TCP socket, owned by this sender.
+        int Socket;
+        /// Options of this sender.
+        BridgeSenderOptions Options;
+        /// Whether SO_ZEROCOPY is enabled on the socket.
+        bool ZeroCopy {false};
+        /// Count of sends made with MSG_ZEROCOPY, the identifier of the next one.
+        std::uint32_t SendCount {0};
+        /// Count of sends made with MSG_ZEROCOPY which are completed without a gap from the first one.
+        std::uint32_t CompletedCount {0};
+        /// Completion of the sends from CompletedCount on, for completions may be reported out of order.
+        std::deque<bool> CompletedSends;
+        /// Sequence number of the last sent picture.
+        std::uint64_t LastSequence {0};
+        /// Batches waiting for their zero copy sends to complete.
+        std::deque<PendingBatch> InFlight;
+        /// Count of leases held by the batches in flight.
+        std::size_t HeldLeases {0};
+
+        /// Max count of leases held at the same time.
+        [[nodiscard]] std::size_t GetMaxHeldLeases() const;
+        /// Wait for the next published picture until the deadline, and hold it if it is newer than the last sent.
+        ReadLease WaitPicture(std::chrono::steady_clock::time_point deadline);
+        /**
+         * @brief Send all bytes described by the message.
+         * @param message Message to send, its iovec array is advanced over the sent bytes.
+         * @param zero_copy Whether to send with MSG_ZEROCOPY, every such send increases SendCount.
+         * @throws runtime_error If the connection is broken, parts sent before are still sent.
+         */
+        void SendMessage(msghdr& message, bool zero_copy);
+        /// Check whether the zero copy send with the given identifier is completed.
+        [[nodiscard]] bool IsSendCompleted(std::uint32_t send) const;
+        /**
+         * @brief Reap the completions of the zero copy sends and release the leases of the completed batches.
+         * @param timeout Max time to wait for a completion if none is reported yet, 0 to not wait.
+         */
+        void ReapCompletions(std::chrono::milliseconds timeout);
+
+    public:
+        /**
+         * @brief Construct a sender of the pictures of the reader over the socket.
+         * @param reader Reader of a ring layout block which is not in the queue mode, opened in read-write mode.
+         * @param socket Connected TCP socket, owned by the sender from now on and closed even if construction fails.
+         * @param options Options of the batches.
+         * @throws runtime_error If the options are invalid.
+         */
+        BridgeSender(PictureReader& reader, int socket, const BridgeSenderOptions& options = BridgeSenderOptions());
+        /**
+         * @brief Wait for the sends in flight, then close the socket before the leases are released.
+         * @details
+         *  If the sends do not complete in time, the socket is closed with a zero linger time, which resets the
+         *  connection and purges its send queue, so the bytes of slots the writer may overwrite are never sent.
+         */
+        ~BridgeSender();
+
+        BridgeSender(const BridgeSender&) = delete;
+        BridgeSender& operator=(const BridgeSender&) = delete;
+
+        /// Check whether the socket sends with MSG_ZEROCOPY.
+        [[nodiscard]] inline bool IsZeroCopy() const noexcept
+        {
+            return ZeroCopy;
+        }
+
+        /**
+         * @brief Wait for newly published pictures and send them as one batch.
+         * @param timeout Max time to wait for the first picture of the batch.
+         * @return Count of sent frames, 0 if no picture is published before the timeout.
+         * @throws runtime_error If the connection is broken, or a picture can not be leased.
+         */
+        std::size_t SendBatch(std::chrono::microseconds timeout);
+
+        /**
+         * @brief Wait until all zero copy sends are completed and release their leases.
+         * @param timeout Max time to wait.
+         * @return Whether all sends are completed.
+         */
+        bool Flush(std::chrono::milliseconds timeout);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include <GaiaSharedPicture/GaiaSharedPicture.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "BridgeReceiver.hpp"
+#include "BridgeSender.hpp"
+
+using namespace Gaia::SharedPicture;
+
+/// Whether the sender keeps running, cleared by SIGINT and SIGTERM.
+volatile std::sig_atomic_t Running = 1;
+
+/// Stop the sender, so its leases are released before it exits.
+void Stop(int)
+{
+    Running = 0;
+}
+
+/// Print the usage of this tool.
+void PrintUsage()
+{
+    std::cerr << "Usage: gaia-shared-picture-bridge send <block name> <host> <port> "
+                 "[batch size] [batch delay us] [raw|delta-rle]\n"
+              << "  Stream the pictures of a ring layout block to a receiver, in batches of up to batch size\n"
+              << "  pictures, 1 by default, waiting up to batch delay for more pictures, 0 by default.\n"
+              << "       gaia-shared-picture-bridge receive <port> <block name> [max picture size] [slot count] "
+                 "[max received size]\n"
+              << "  Publish the streamed pictures into a resizable ring layout block, created with the given\n"
+              << "  max picture size, 8294400 by default, and slot count, 3 by default. Pictures bigger than\n"
+              << "  max received size, 268435456 by default, close the connection."
+              << std::endl;
+}
+
+/**
+ * @brief Resolve the address and connect or listen to it.
+ * @param host Host to connect to, or null to listen on all addresses.
+ * @param port Port to connect or listen to.
+ * @return Connected or listening TCP socket.
+ * @throws runtime_error If no resolved address can be connected or listened to.
+ */
+int OpenSocket(const char* host, const char* port)
+{
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = host ? 0 : AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    if (auto result = ::getaddrinfo(host, port, &hints, &addresses); result != 0)
+    {
+        throw std::runtime_error(std::string("Failed to resolve address: ") + ::gai_strerror(result));
+    }
+    int error = 0;
+    for (auto* address = addresses; address; address = address->ai_next)
+    {
+        auto descriptor = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+        if (descriptor < 0)
+        {
+            error = errno;
+            continue;
+        }
+        int enable = 1;
+        bool opened;
+        if (host)
+        {
+            ::setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            opened = ::connect(descriptor, address->ai_addr, address->ai_addrlen) == 0;
+        }
+        else
+        {
+            ::setsockopt(descriptor, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+            opened = ::bind(descriptor, address->ai_addr, address->ai_addrlen) == 0 && ::listen(descriptor, 1) == 0;
+        }
+        if (opened)
+        {
+            ::freeaddrinfo(addresses);
+            return descriptor;
+        }
+        error = errno;
+        ::close(descriptor);
+    }
+    ::freeaddrinfo(addresses);
+    throw std::runtime_error(std::string("Failed to open socket: ") + std::strerror(error));
+}
+
+/// Stream the pictures of a block to a receiver, reconnecting until it is stopped.
+int Send(int argc, char** argv)
+{
+    BridgeSenderOptions options;
+    if (argc > 5) options.BatchSize = static_cast<unsigned int>(std::max(1, std::atoi(argv[5])));
+    if (argc > 6) options.BatchDelay = std::chrono::microseconds(std::max(0, std::atoi(argv[6])));
+    if (argc > 7)
+    {
+        if (std::strcmp(argv[7], "delta-rle") == 0) options.Codec = PayloadCodecs::DeltaRle;
+        else if (std::strcmp(argv[7], "raw") != 0)
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    struct sigaction action {};
+    action.sa_handler = Stop;
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGTERM, &action, nullptr);
+
+    PictureReader reader(argv[2]);
+    while (Running)
+    {
+        try
+        {
+            // The sender owns the socket, and closes it when it is destroyed.
+            BridgeSender sender(reader, OpenSocket(argv[3], argv[4]), options);
+            std::cerr << "Streaming block " << argv[2] << " to " << argv[3] << ":" << argv[4]
+                      << (sender.IsZeroCopy() ? " with" : " without") << " MSG_ZEROCOPY." << std::endl;
+            while (Running)
+                sender.SendBatch(std::chrono::milliseconds(100));
+        }catch(std::exception& error)
+        {
+            std::cerr << "Failed to stream block " << argv[2] << ": " << error.what() << std::endl;
+        }
+        if (Running) std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    return 0;
+}
+
+/// Publish the pictures of every accepted connection into a local block.
+int Receive(int argc, char** argv)
+{
+    auto max_picture_size = argc > 4 ? static_cast<unsigned int>(std::strtoul(argv[4], nullptr, 10)) : 8294400u;
+    BlockOptions options;
+    options.Layout = BlockOptions::Layouts::Ring;
+    options.SlotCount = argc > 5 ? static_cast<unsigned int>(std::max(2, std::atoi(argv[5]))) : 3;
+    options.Resizable = true;
+    BridgeReceiverOptions receiver_options;
+    if (argc > 6) receiver_options.MaxPictureSize = std::strtoull(argv[6], nullptr, 10);
+
+    PictureWriter writer(argv[3], max_picture_size, true, options);
+    auto listener = OpenSocket(nullptr, argv[2]);
+    std::cerr << "Publishing pictures received on port " << argv[2] << " into block " << argv[3] << "." << std::endl;
+    while (true)
+    {
+        auto descriptor = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (descriptor < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::cerr << "Failed to accept connection: " << std::strerror(errno) << std::endl;
+            ::close(listener);
+            return 1;
+        }
+        try
+        {
+            BridgeReceiver receiver(writer, descriptor, receiver_options);
+            std::size_t published;
+            while (receiver.ReceiveBatch(published))
+            {}
+        }catch(std::exception& error)
+        {
+            std::cerr << "Failed to receive pictures: " << error.what() << std::endl;
+        }
+        ::close(descriptor);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc >= 5 && std::strcmp(argv[1], "send") == 0) return Send(argc, argv);
+        if (argc >= 4 && std::strcmp(argv[1], "receive") == 0) return Receive(argc, argv);
+    }catch(std::exception& error)
+    {
+        std::cerr << "Failed to run bridge: " << error.what() << std::endl;
+        return 1;
+    }
+    PrintUsage();
+    return 1;
+}
\ No newline at end of file
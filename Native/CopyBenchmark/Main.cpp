@@ -0,0 +1,68 @@
+#include <GaiaSharedPicture/GaiaSharedPicture.hpp>
+#include <GaiaSharedPicture/PictureCopier.hpp>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+using namespace Gaia::SharedPicture;
+
+/// Run the copy repeatedly and print its throughput in GB/s.
+void Measure(const std::string& name, std::size_t bytes, const std::function<void()>& copy)
+{
+    copy();
+    int iterations = 0;
+    auto begin = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed {0};
+    while (elapsed.count() < 1.0)
+    {
+        copy();
+        ++iterations;
+        elapsed = std::chrono::steady_clock::now() - begin;
+    }
+    std::cout << std::left << std::setw(46) << name << std::right << std::setw(12) << bytes << " bytes "
+              << std::fixed << std::setprecision(2) << std::setw(8)
+              << static_cast<double>(bytes) * iterations / elapsed.count() / 1e9 << " GB/s" << std::endl;
+}
+
+int main()
+{
+    // Widths are 2 pixels short of the common ones, so rows of 3 channels are not multiples of 64 bytes
+    // and the row aligned writer really pads them.
+    const cv::Size sizes[] = {{638, 480}, {1918, 1080}, {3838, 2160}};
+
+    BlockOptions options;
+    options.Layout = BlockOptions::Layouts::Ring;
+    options.SlotCount = 2;
+    PictureWriter writer("copy_benchmark", 4096 * 2304 * 3, true, options);
+    options.RowAlignment = 64;
+    PictureWriter padded_writer("copy_benchmark_padded", 4096 * 2304 * 3, true, options);
+
+    for (const auto& size : sizes)
+    {
+        cv::Mat picture(size, CV_8UC3);
+        cv::randu(picture, cv::Scalar::all(0), cv::Scalar::all(255));
+        cv::Mat canvas(size.height + 64, size.width + 64, CV_8UC3);
+        cv::randu(canvas, cv::Scalar::all(0), cv::Scalar::all(255));
+        cv::Mat roi = canvas(cv::Rect(32, 32, size.width, size.height));
+        auto bytes = picture.total() * picture.elemSize();
+        auto suffix = " " + std::to_string(size.width) + "x" + std::to_string(size.height);
+
+        cv::Mat heap_destination(size, CV_8UC3);
+        Measure("cv::Mat::copyTo continuous" + suffix, bytes, [&]{ picture.copyTo(heap_destination); });
+        Measure("cv::Mat::copyTo ROI" + suffix, bytes, [&]{ roi.copyTo(heap_destination); });
+        Measure("PictureCopier continuous" + suffix, bytes, [&]{
+            PictureCopier::Copy(picture, heap_destination);
+        });
+        Measure("PictureCopier ROI" + suffix, bytes, [&]{ PictureCopier::Copy(roi, heap_destination); });
+        Measure("PictureWriter::Write continuous" + suffix, bytes, [&]{ writer.Write(picture); });
+        Measure("PictureWriter::Write ROI" + suffix, bytes, [&]{ writer.Write(roi); });
+        Measure("PictureWriter::Write padded rows" + suffix, bytes, [&]{ padded_writer.Write(picture); });
+    }
+
+    writer.Release();
+    padded_writer.Release();
+    boost::interprocess::shared_memory_object::remove("copy_benchmark");
+    boost::interprocess::shared_memory_object::remove("copy_benchmark_padded");
+    return 0;
+}
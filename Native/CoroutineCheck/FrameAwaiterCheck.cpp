@@ -0,0 +1,45 @@
+#include <GaiaSharedPicture/FrameEventLoop.hpp>
+
+// Compiled as C++20 only, so FrameAwaiter, which C++17 builds of the library never see, keeps compiling.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <exception>
+
+namespace Gaia::SharedPicture
+{
+    /// Minimal coroutine type which starts eagerly and is never awaited.
+    struct CheckTask
+    {
+        struct promise_type
+        {
+            CheckTask get_return_object()
+            {
+                return {};
+            }
+            std::suspend_never initial_suspend() noexcept
+            {
+                return {};
+            }
+            std::suspend_never final_suspend() noexcept
+            {
+                return {};
+            }
+            void return_void()
+            {}
+            void unhandled_exception()
+            {
+                std::terminate();
+            }
+        };
+    };
+
+    /// Await pictures of the reader the way an application would.
+    CheckTask AwaitFrames(FrameEventLoop& loop, PictureReader& reader)
+    {
+        while (true)
+        {
+            cv::Mat picture = co_await NextFrame(loop, reader);
+            if (picture.empty()) co_return;
+        }
+    }
+}
+#endif
\ No newline at end of file
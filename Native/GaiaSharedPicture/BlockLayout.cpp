@@ -0,0 +1,180 @@
+#include "BlockLayout.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <random>
+
+namespace Gaia::SharedPicture
+{
+    /// Get the offset of the picture bytes from the beginning of a slot.
+    static std::size_t GetPayloadOffset(std::size_t payload_alignment)
+    {
+        return BlockLayout::AlignSize(sizeof(SlotHeader), payload_alignment);
+    }
+
+    /**
+     * @brief Get the bytes reserved for the downsampled levels of a picture of the given size.
+     * @details Levels are halved with the remainders dropped, so level N has at most 1 / 4^N of the picture bytes.
+     */
+    static std::size_t GetPyramidSize(std::size_t max_picture_size, std::size_t payload_alignment,
+                                      unsigned int pyramid_levels)
+    {
+        std::size_t size = 0;
+        for (unsigned int level = 1; level <= pyramid_levels; ++level)
+        {
+            size += BlockLayout::AlignSize(max_picture_size >> (2 * level), payload_alignment);
+        }
+        return size;
+    }
+
+    /// Get the bytes of a slot which can hold a picture of the given size and its downsampled levels.
+    std::size_t BlockLayout::GetSlotSize(std::size_t max_picture_size, std::size_t payload_alignment,
+                                         unsigned int pyramid_levels)
+    {
+        // Every slot begins with a slot header, so slots keep its alignment.
+        return AlignSize(GetPayloadOffset(payload_alignment) + AlignSize(max_picture_size, payload_alignment) +
+                         GetPyramidSize(max_picture_size, payload_alignment, pyramid_levels), alignof(SlotHeader));
+    }
+
+    /// Get the offset of the first slot from the beginning of a block.
+    static std::size_t GetSlotOffset(std::size_t payload_alignment, unsigned int queue_readers)
+    {
+        return BlockLayout::AlignSize(BlockLayout::AlignSize(sizeof(BlockHeader), alignof(ReaderCursor)) +
+                                      queue_readers * sizeof(ReaderCursor),
+                                      std::max(payload_alignment, alignof(SlotHeader)));
+    }
+
+    /// Get the bytes of a ring layout block.
+    std::size_t BlockLayout::GetBlockSize(unsigned int slot_count, std::size_t max_picture_size,
+                                          std::size_t payload_alignment, unsigned int queue_readers,
+                                          unsigned int pyramid_levels)
+    {
+        return GetSlotOffset(payload_alignment, queue_readers) +
+            slot_count * GetSlotSize(max_picture_size, payload_alignment, pyramid_levels);
+    }
+
+    /// Construct a ring layout block header, its reader cursors and its slot headers on the given memory.
+    BlockHeader* BlockLayout::Initialize(unsigned char *memory, unsigned int slot_count, std::size_t max_picture_size,
+                                         std::size_t payload_alignment, std::size_t row_alignment,
+                                         unsigned int queue_readers, unsigned int pyramid_levels,
+                                         unsigned int tile_size)
+    {
+        auto* block = new (memory) BlockHeader;
+        block->SlotCount = slot_count;
+        block->PayloadAlignment = static_cast<std::uint32_t>(payload_alignment);
+        block->RowAlignment = static_cast<std::uint32_t>(row_alignment);
+        block->QueueReaders = queue_readers;
+        block->CursorOffset = AlignSize(sizeof(BlockHeader), alignof(ReaderCursor));
+        block->SlotOffset = GetSlotOffset(payload_alignment, queue_readers);
+        block->SlotSize = GetSlotSize(max_picture_size, payload_alignment, pyramid_levels);
+        block->PayloadOffset = GetPayloadOffset(payload_alignment);
+        block->PyramidLevels = pyramid_levels;
+        block->PyramidOffset = AlignSize(max_picture_size, payload_alignment);
+        block->TileSize = tile_size;
+        for (unsigned int index = 0; index < queue_readers; ++index)
+        {
+            new (GetCursor(memory, index)) ReaderCursor;
+        }
+        for (unsigned int slot = 0; slot < slot_count; ++slot)
+        {
+            new (GetSlotHeader(memory, slot)) SlotHeader;
+        }
+        return block;
+    }
+
+    /// Check whether the memory holds a ring layout block or not.
+    bool BlockLayout::IsRing(const unsigned char *memory, std::size_t memory_size)
+    {
+        if (memory_size < sizeof(BlockHeader)) return false;
+        const auto* block = reinterpret_cast<const BlockHeader*>(memory);
+        if (block->Magic != BlockMagic || block->Version != BlockVersion) return false;
+        // Headers of foreign or corrupt blocks must not overflow the bounds checks.
+        return block->SlotCount != 0 && block->SlotOffset >= sizeof(BlockHeader) &&
+            block->CursorOffset + block->QueueReaders * sizeof(ReaderCursor) <= block->SlotOffset &&
+            block->PayloadOffset >= sizeof(SlotHeader) && block->SlotSize >= block->PayloadOffset &&
+            block->PyramidOffset <= block->SlotSize - block->PayloadOffset &&
+            block->PyramidLevels <= MaxPyramidLevels &&
+            block->SlotOffset <= memory_size &&
+            block->SlotCount <= (memory_size - block->SlotOffset) / block->SlotSize;
+    }
+
+    /// Count nanoseconds into the bucket of a histogram.
+    void BlockStatistics::Record(std::atomic<std::uint64_t> *histogram, std::int64_t nanoseconds)
+    {
+        unsigned int bucket = 0;
+        for (auto value = nanoseconds; value > 1 && bucket + 1 < HistogramBuckets; value >>= 1) ++bucket;
+        histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Get the header of a ring layout block.
+    BlockHeader* BlockLayout::GetBlockHeader(unsigned char *memory)
+    {
+        return reinterpret_cast<BlockHeader*>(memory);
+    }
+
+    /// Get the header of the slot with the given index.
+    SlotHeader* BlockLayout::GetSlotHeader(unsigned char *memory, unsigned int slot)
+    {
+        auto* block = GetBlockHeader(memory);
+        return reinterpret_cast<SlotHeader*>(memory + block->SlotOffset + slot * block->SlotSize);
+    }
+
+    /// Get the address of the picture bytes in the slot with the given index.
+    unsigned char* BlockLayout::GetSlotPointer(unsigned char *memory, unsigned int slot)
+    {
+        return reinterpret_cast<unsigned char*>(GetSlotHeader(memory, slot)) + GetBlockHeader(memory)->PayloadOffset;
+    }
+
+    /// Get the reader cursor with the given index of a block in the queue mode.
+    ReaderCursor* BlockLayout::GetCursor(unsigned char *memory, unsigned int index)
+    {
+        return reinterpret_cast<ReaderCursor*>(memory + GetBlockHeader(memory)->CursorOffset) + index;
+    }
+
+    /// Get the max picture bytes of a slot in the given block.
+    std::size_t BlockLayout::GetSlotCapacity(const BlockHeader *block)
+    {
+        return block->PyramidOffset;
+    }
+
+    /// Get the row stride of a picture with the given row bytes in the given block.
+    std::size_t BlockLayout::GetRowStride(const BlockHeader *block, std::size_t row_size)
+    {
+        return AlignSize(row_size, block->RowAlignment);
+    }
+
+    /// Get the time stamp in nanoseconds of the steady clock.
+    std::int64_t BlockLayout::GetTimeStamp()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// Get the name of the block of the given generation.
+    std::string BlockLayout::GetGenerationName(const std::string &base_name, std::uint32_t generation)
+    {
+        if (generation == 0) return base_name;
+        return base_name + "." + std::to_string(generation);
+    }
+
+    /// Make a random non-zero token identifying the owner of a queue cursor.
+    std::uint64_t BlockLayout::MakeOwnerToken()
+    {
+        // Process identifiers are neither unique across PID namespaces nor over time, random tokens are.
+        std::random_device device;
+        std::uint64_t token = 0;
+        while (token == 0)
+        {
+            token = static_cast<std::uint64_t>(device()) << 32 | device();
+        }
+        return token;
+    }
+
+    /// Check whether a queue cursor is registered by a reader with a recent heartbeat.
+    bool BlockLayout::IsCursorActive(const ReaderCursor* cursor)
+    {
+        return cursor->Owner.load(std::memory_order_acquire) != 0 &&
+               GetTimeStamp() - cursor->Heartbeat.load(std::memory_order_relaxed) <= CursorTimeout;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "HeaderCoder.hpp"
+#include "PayloadCodec.hpp"
+
+namespace Gaia::SharedPicture
+{
+    /// Options describing how a shared memory block is laid out.
+    struct BlockOptions
+    {
+        /// Layout of the shared memory block.
+        enum class Layouts
+        {
+            /// One picture behind a 10-byte header, compatible with old readers and writers.
+            Single,
+            /// Several picture slots behind a block header, the newest complete slot is published atomically.
+            Ring
+        } Layout {Layouts::Single};
+        /// Count of picture slots, only used by the ring layout, must not be lesser than 2.
+        unsigned int SlotCount {3};
+        /// Alignment of the picture bytes of every slot, only used by the ring layout, must be a power of 2.
+        std::size_t PayloadAlignment {64};
+        /// Alignment of every row of a picture, only used by the ring layout, must be a power of 2.
+        std::size_t RowAlignment {1};
+        /**
+         * @brief Whether the writer moves to a bigger block instead of refusing a picture bigger than its max size.
+         * @details
+         *  Only used by the ring layout in POSIX shared memory. The bigger block is a new generation named
+         *  "name.N", readers move to it on their next read.
+         */
+        bool Resizable {false};
+        /**
+         * @brief Whether every picture is queued for the readers consuming the queue, only used by the ring layout.
+         * @details
+         *  Slots are overwritten in order without being held, so a reader which is lapped by the writer
+         *  learns how many pictures it has dropped. It can not be resizable.
+         */
+        bool QueueMode {false};
+        /// Max count of readers consuming the queue at the same time, only used in the queue mode.
+        unsigned int MaxQueueReaders {16};
+        /**
+         * @brief Count of downsampled levels published with every 2-dimensional picture, only used by the ring layout.
+         * @details
+         *  Every level is half the width and height of the previous one, up to MaxPyramidLevels levels,
+         *  produced once by the writer and read by PictureReader::Read(unsigned int) without copying.
+         */
+        unsigned int PyramidLevels {0};
+        /**
+         * @brief Side in pixels of the square tiles compared by the writer, 0 to rewrite every picture completely.
+         * @details
+         *  Only used by the ring layout. PictureWriter::Write(const cv::Mat&) only copies the tiles which differ
+         *  from the picture left in the slot, and publishes which tiles differ from the previous picture,
+         *  see PictureReader::GetChangedTiles().
+         */
+        unsigned int TileSize {0};
+    };
+
+    /// Max count of downsampled levels published with a picture.
+    constexpr unsigned int MaxPyramidLevels = 4;
+    /// Max count of tiles of a picture whose changes can be published, pictures with more tiles are all changed.
+    constexpr unsigned int MaxDirtyTiles = 4096;
+    /// Max count of readiness channels subscribed to a ring layout block.
+    constexpr unsigned int MaxReadinessSubscribers = 64;
+    /// Nanoseconds without a heartbeat after which a queue cursor is considered abandoned and can be taken over.
+    constexpr std::int64_t CursorTimeout = 10000000000;
+
+    /// Magic number at the beginning of a ring layout block, "GSPB" in little endian.
+    constexpr std::uint32_t BlockMagic = 0x42505347;
+    /// Version of the ring layout.
+    constexpr std::uint32_t BlockVersion = 13;
+    /// Slot index which means no slot.
+    constexpr std::uint32_t NoSlot = 0xFFFFFFFF;
+    /// Sequence lock of a slot held for a picture allocated in place, odd like a write and never a real sequence.
+    constexpr std::uint64_t HeldSlotSequence = 0xFFFFFFFFFFFFFFFF;
+
+    /**
+     * @brief Counters and latency histograms of a ring layout block, updated with relaxed atomics.
+     * @details
+     *  The writer updates the write counters, and readers which can write the block update the read counters,
+     *  so monitoring tools can attach in read-only mode and compute rates from snapshots.
+     */
+    struct alignas(64) BlockStatistics
+    {
+        /// Count of log2 buckets of a histogram, bucket N counts nanoseconds in [2^N, 2^(N+1)), the last one the rest.
+        static constexpr unsigned int HistogramBuckets = 40;
+
+        /// Count of published pictures.
+        std::atomic<std::uint64_t> WrittenPictures {0};
+        /// Bytes of published pictures as stored in the slots.
+        std::atomic<std::uint64_t> WrittenBytes {0};
+        /// Total nanoseconds between acquiring slots and publishing them.
+        std::atomic<std::uint64_t> WriteTime {0};
+        /// Count of writes refused for all slots are held by readers.
+        std::atomic<std::uint64_t> RefusedWrites {0};
+        /// Count of pictures read.
+        std::atomic<std::uint64_t> ReadPictures {0};
+        /// Count of copies retried for the writer has changed the slot while it is being copied.
+        std::atomic<std::uint64_t> TornReads {0};
+        /// Count of pictures dropped by readers consuming the queue.
+        std::atomic<std::uint64_t> DroppedPictures {0};
+        /// Histogram of nanoseconds between acquiring slots and publishing them.
+        std::atomic<std::uint64_t> WriteLatency[HistogramBuckets] {};
+        /// Histogram of nanoseconds between publishing pictures and reading them.
+        std::atomic<std::uint64_t> ReadLag[HistogramBuckets] {};
+
+        /// Count nanoseconds into the bucket of a histogram.
+        static void Record(std::atomic<std::uint64_t>* histogram, std::int64_t nanoseconds);
+    };
+
+    /// Header at the beginning of a ring layout block.
+    struct BlockHeader
+    {
+        /// Magic number, must be BlockMagic.
+        std::uint32_t Magic {BlockMagic};
+        /// Version of the layout.
+        std::uint32_t Version {BlockVersion};
+        /// Count of slots in this block.
+        std::uint32_t SlotCount {0};
+        /// Alignment of the picture bytes of every slot.
+        std::uint32_t PayloadAlignment {1};
+        /// Alignment of every row of pictures in this block.
+        std::uint32_t RowAlignment {1};
+        /// Offset of the first slot from the beginning of this block.
+        std::uint64_t SlotOffset {0};
+        /// Bytes of each slot, including its slot header.
+        std::uint64_t SlotSize {0};
+        /// Offset of the picture bytes from the beginning of a slot.
+        std::uint64_t PayloadOffset {0};
+        /// Count of reader cursors, 0 if the block is not in the queue mode.
+        std::uint32_t QueueReaders {0};
+        /// Offset of the reader cursor table from the beginning of this block.
+        std::uint64_t CursorOffset {0};
+        /// Count of downsampled levels reserved in every slot.
+        std::uint32_t PyramidLevels {0};
+        /// Offset of the downsampled levels from the picture bytes of a slot, which is also the max picture bytes.
+        std::uint64_t PyramidOffset {0};
+        /// Side in pixels of the tiles compared by the writer, 0 if pictures are rewritten completely.
+        std::uint32_t TileSize {0};
+        /// Generation of this block, 0 for the block with the base name.
+        std::uint32_t Generation {0};
+        /**
+         * @brief Newest generation of the block, 0 if this block is still in use.
+         * @details
+         *  It is set in the retired block and in the block of generation 0, which is kept for readers to find the
+         *  newest generation, while retired blocks of other generations are removed.
+         */
+        std::atomic<std::uint32_t> NextGeneration {0};
+        /// Index of the newest completely written slot, or NoSlot if nothing is published yet.
+        std::atomic<std::uint32_t> LatestSlot {NoSlot};
+        /// Sequence number of the newest published picture, starts from 1, 0 means nothing is published yet.
+        std::atomic<std::uint64_t> Sequence {0};
+        /// Notification word, increased after every publication, readers wait on it for new pictures.
+        std::atomic<std::uint32_t> Notification {0};
+        /// Count of readers waiting on the notification word, the writer only wakes them up if it is not 0.
+        std::atomic<std::uint32_t> Waiters {0};
+        /// Count of subscribed readiness channels, the writer only notifies them if it is not 0.
+        std::atomic<std::uint32_t> ReadinessSubscribers {0};
+        /// Count of readiness channel entries ever taken, the writer only scans the entries below it.
+        std::atomic<std::uint32_t> ReadinessEntries {0};
+        /// Identifiers of the subscribed readiness channels, 0 for free entries.
+        std::atomic<std::uint64_t> ReadinessChannels[MaxReadinessSubscribers] {};
+        /// Counters and histograms of this block, on their own cache lines.
+        BlockStatistics Statistics;
+    };
+
+    /// Geometry of a downsampled level of the picture in a slot, its pixel type is the one of the picture.
+    struct PyramidLevel
+    {
+        /// Offset of the level from the picture bytes of the slot.
+        std::uint64_t Offset {0};
+        /// Count of rows of the level, whose rows are continuous.
+        std::uint32_t Rows {0};
+        /// Count of columns of the level.
+        std::uint32_t Columns {0};
+    };
+
+    /**
+     * @brief Metadata of a picture, published atomically with the picture bytes in its slot.
+     * @details It takes whole cache lines, so filling it does not share cache lines with the other slot fields.
+     */
+    struct alignas(64) FrameMetadata
+    {
+        /// Max bytes of the user data.
+        static constexpr std::size_t MaxUserDataSize = 224;
+
+        /// Capture time stamp in nanoseconds of the steady clock, set by the writer caller, 0 if unknown.
+        std::int64_t CaptureTime {0};
+        /// Publication time stamp in nanoseconds of the steady clock, set by the writer when the picture is published.
+        std::int64_t PublishTime {0};
+        /// Identifier of the source of the picture, such as a camera or a calibration, defined by the user.
+        std::uint64_t SourceId {0};
+        /// Bytes of the user data.
+        std::uint32_t UserDataSize {0};
+        /// User data, such as exposure settings or a small key/value table, defined by the user.
+        unsigned char UserData[MaxUserDataSize] {};
+    };
+
+    static_assert(sizeof(FrameMetadata) == 256, "Frame metadata must take whole cache lines.");
+
+    /// Header at the beginning of every slot in a ring layout block.
+    struct SlotHeader
+    {
+        /**
+         * @brief Sequence lock of this slot.
+         * @details
+         *  It is twice the sequence number of the picture in this slot, and it is odd while the writer is writing,
+         *  so a reader can detect that the picture has been changed while it is being copied.
+         */
+        std::atomic<std::uint64_t> Sequence {0};
+        /// Count of readers holding this slot, the writer never overwrites a held slot.
+        std::atomic<std::uint32_t> Readers {0};
+        /// Bytes between the beginnings of two adjacent rows of the picture in this slot.
+        std::uint64_t RowStride {0};
+        /// Picture header encoded by HeaderCoder::EncodeExtended.
+        unsigned char Picture[HeaderCoder::ExtendedHeaderSize] {};
+        /// Codec of the picture bytes in this slot.
+        PayloadCodecs Codec {PayloadCodecs::Raw};
+        /// Bytes of the encoded picture, only used if the codec is not raw.
+        std::uint64_t EncodedSize {0};
+        /// Count of downsampled levels published with the picture in this slot.
+        std::uint32_t LevelCount {0};
+        /// Geometry of the downsampled levels, from the biggest to the smallest.
+        PyramidLevel Levels[MaxPyramidLevels] {};
+        /// Count of tile columns of the picture in this slot, 0 if its changed tiles are unknown.
+        std::uint32_t TileColumns {0};
+        /// Count of tile rows of the picture in this slot.
+        std::uint32_t TileRows {0};
+        /// Sequence number of the picture the changed tiles are compared with, 0 if all tiles are changed.
+        std::uint64_t TileBase {0};
+        /// Bitmap of the tiles changed since the base picture, in row major order.
+        std::uint64_t DirtyTiles[MaxDirtyTiles / 64] {};
+        /// Metadata of the picture in this slot, protected by the sequence lock like the picture bytes.
+        FrameMetadata Metadata;
+    };
+
+    /// Cursor of a reader consuming the queue of a block in the queue mode.
+    struct ReaderCursor
+    {
+        /// Random token of the reader which has registered this cursor, 0 if it is free.
+        std::atomic<std::uint64_t> Owner {0};
+        /// Steady clock time stamp in nanoseconds, refreshed by the owner whenever it dequeues or waits.
+        std::atomic<std::int64_t> Heartbeat {0};
+        /// Sequence number of the next picture the reader will consume.
+        std::atomic<std::uint64_t> Position {0};
+        /// Count of pictures overwritten by the writer before the reader has consumed them.
+        std::atomic<std::uint64_t> Dropped {0};
+    };
+
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free &&
+                  std::atomic<std::uint64_t>::is_always_lock_free &&
+                  std::atomic<std::int64_t>::is_always_lock_free,
+            "Atomic counters in shared memory must be lock free.");
+
+    /**
+     * @brief Ring layout helper, providing address and size calculations of blocks and slots.
+     */
+    class BlockLayout
+    {
+    public:
+        /// Round the size up to a multiple of the alignment, which must be a power of 2.
+        static constexpr std::size_t AlignSize(std::size_t size, std::size_t alignment)
+        {
+            return (size + alignment - 1) & ~(alignment - 1);
+        }
+
+        /// Get the bytes of a slot which can hold a picture of the given size and its downsampled levels.
+        static std::size_t GetSlotSize(std::size_t max_picture_size, std::size_t payload_alignment,
+                                       unsigned int pyramid_levels = 0);
+        /// Get the bytes of a ring layout block, with a reader cursor table in the queue mode.
+        static std::size_t GetBlockSize(unsigned int slot_count, std::size_t max_picture_size,
+                                        std::size_t payload_alignment, unsigned int queue_readers = 0,
+                                        unsigned int pyramid_levels = 0);
+
+        /**
+         * @brief Construct a ring layout block header on the given memory.
+         * @param memory Address of the shared memory block, must be aligned to the payload alignment.
+         * @param slot_count Count of slots.
+         * @param max_picture_size Max picture bytes of every slot.
+         * @param payload_alignment Alignment of the picture bytes of every slot.
+         * @param row_alignment Alignment of every row of pictures.
+         * @param queue_readers Count of reader cursors, 0 if the block is not in the queue mode.
+         * @param pyramid_levels Count of downsampled levels reserved in every slot.
+         * @param tile_size Side in pixels of the tiles compared by the writer, 0 if pictures are rewritten completely.
+         */
+        static BlockHeader* Initialize(unsigned char* memory, unsigned int slot_count, std::size_t max_picture_size,
+                                       std::size_t payload_alignment, std::size_t row_alignment,
+                                       unsigned int queue_readers = 0, unsigned int pyramid_levels = 0,
+                                       unsigned int tile_size = 0);
+
+        /**
+         * @brief Check whether the memory holds a ring layout block or not.
+         * @param memory Address of the shared memory block.
+         * @param memory_size Bytes of the shared memory block.
+         * @retval true The block is in the ring layout and its slots fit in the memory.
+         * @retval false The block is in the single layout or is broken.
+         */
+        static bool IsRing(const unsigned char* memory, std::size_t memory_size);
+
+        /// Get the header of a ring layout block.
+        static BlockHeader* GetBlockHeader(unsigned char* memory);
+        /// Get the header of the slot with the given index.
+        static SlotHeader* GetSlotHeader(unsigned char* memory, unsigned int slot);
+        /// Get the address of the picture bytes in the slot with the given index.
+        static unsigned char* GetSlotPointer(unsigned char* memory, unsigned int slot);
+        /// Get the reader cursor with the given index of a block in the queue mode.
+        static ReaderCursor* GetCursor(unsigned char* memory, unsigned int index);
+        /// Get the max picture bytes of a slot in the given block.
+        static std::size_t GetSlotCapacity(const BlockHeader* block);
+        /// Get the row stride of a picture with the given row bytes in the given block.
+        static std::size_t GetRowStride(const BlockHeader* block, std::size_t row_size);
+        /// Get the time stamp in nanoseconds of the steady clock, used by queue cursors, frame metadata and statistics.
+        static std::int64_t GetTimeStamp();
+        /// Get the name of the block of the given generation.
+        static std::string GetGenerationName(const std::string& base_name, std::uint32_t generation);
+        /// Make a random non-zero token identifying the owner of a queue cursor in any process or PID namespace.
+        static std::uint64_t MakeOwnerToken();
+        /// Check whether a queue cursor is registered by a reader whose heartbeat is not older than CursorTimeout.
+        static bool IsCursorActive(const ReaderCursor* cursor);
+    };
+}
\ No newline at end of file
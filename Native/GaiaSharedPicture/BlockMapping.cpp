@@ -0,0 +1,109 @@
+#include "BlockMapping.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/vfs.h>
+#endif
+
+namespace Gaia::SharedPicture
+{
+    #ifdef __linux__
+    /// Magic number of hugetlbfs in the file system type of statfs.
+    constexpr long HugeTlbFsMagic = 0x958458f6;
+    /// Memory policy allocating pages only on the given nodes, defined in linux/mempolicy.h.
+    constexpr int MemoryPolicyBind = 2;
+    /// Flag moving pages already allocated on other nodes, defined in linux/mempolicy.h.
+    constexpr unsigned int MemoryPolicyMove = 1 << 1;
+    /// Count of NUMA nodes supported by the node mask.
+    constexpr int MaxNumaNodes = 1024;
+    #endif
+
+    /// Get the path of the huge page file of the block with the given name.
+    std::string BlockMapping::GetHugePagePath(const MappingOptions& options, const std::string& shared_block_name)
+    {
+        return options.HugePageDirectory + "/" + shared_block_name;
+    }
+
+    /// Create or truncate the huge page file of a block.
+    void BlockMapping::CreateHugePageFile(const MappingOptions &options, const std::string &path, std::size_t size)
+    {
+        #ifdef __linux__
+        struct statfs file_system {};
+        if (::statfs(options.HugePageDirectory.c_str(), &file_system) != 0 ||
+            static_cast<long>(file_system.f_type) != HugeTlbFsMagic)
+        {
+            throw std::runtime_error("Failed to create huge page file: " + options.HugePageDirectory +
+                                     " is not a hugetlbfs mount.");
+        }
+        // Files on hugetlbfs can only be truncated to multiples of the huge page size.
+        auto page_size = static_cast<std::size_t>(file_system.f_bsize);
+        size = (size + page_size - 1) / page_size * page_size;
+        auto descriptor = ::open(path.c_str(), O_RDWR | O_CREAT, 0666);
+        if (descriptor < 0)
+        {
+            throw std::runtime_error("Failed to create huge page file " + path + ": " + std::strerror(errno));
+        }
+        auto result = ::ftruncate(descriptor, static_cast<off_t>(size));
+        auto error = errno;
+        ::close(descriptor);
+        if (result != 0)
+        {
+            throw std::runtime_error("Failed to resize huge page file " + path + ": " + std::strerror(error));
+        }
+        #else
+        (void)options;
+        (void)path;
+        (void)size;
+        throw std::runtime_error("Failed to create huge page file: hugetlbfs is only supported on Linux.");
+        #endif
+    }
+
+    /// Apply the mapping options to a mapped block.
+    void BlockMapping::Prepare(void *address, std::size_t size, const MappingOptions &options, bool creating)
+    {
+        if (!address || size == 0) return;
+        #ifdef __linux__
+        if (options.TransparentHugePages && options.HugePageDirectory.empty())
+        {
+            // Only a hint, the kernel may ignore it according to its shmem huge page settings.
+            ::madvise(address, size, MADV_HUGEPAGE);
+        }
+        if (creating && options.NumaNode >= 0)
+        {
+            if (options.NumaNode >= MaxNumaNodes)
+                throw std::runtime_error("Failed to bind shared picture: NUMA node is out of range.");
+            unsigned long node_mask[MaxNumaNodes / (8 * sizeof(unsigned long))] {};
+            node_mask[options.NumaNode / (8 * sizeof(unsigned long))] |=
+                    1UL << (options.NumaNode % (8 * sizeof(unsigned long)));
+            if (::syscall(SYS_mbind, address, size, MemoryPolicyBind, node_mask, MaxNumaNodes + 1,
+                          MemoryPolicyMove) != 0)
+            {
+                throw std::runtime_error(std::string("Failed to bind shared picture to NUMA node: ") +
+                                         std::strerror(errno));
+            }
+        }
+        #endif
+        if (!options.Prefault) return;
+
+        #if defined(MADV_POPULATE_WRITE) && defined(MADV_POPULATE_READ)
+        if (::madvise(address, size, creating ? MADV_POPULATE_WRITE : MADV_POPULATE_READ) == 0) return;
+        #endif
+        // Touch every page on kernels without MADV_POPULATE_*; a just created block is not used by anyone else,
+        // so its pages can be written, while pages of an opened block are only read.
+        auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        auto* bytes = static_cast<volatile unsigned char*>(address);
+        for (std::size_t offset = 0; offset < size; offset += page_size)
+        {
+            if (creating) bytes[offset] = bytes[offset];
+            else (void)bytes[offset];
+        }
+    }
+}
\ No newline at end of file
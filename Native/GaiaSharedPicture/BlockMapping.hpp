@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Gaia::SharedPicture
+{
+    /// Options describing how a shared memory block is backed and mapped.
+    struct MappingOptions
+    {
+        /**
+         * @brief Directory of a mounted hugetlbfs, such as "/dev/hugepages".
+         * @details
+         *  If not empty, the block is a file in this directory backed by huge pages,
+         *  instead of a POSIX shared memory object. Readers must be given the same directory.
+         */
+        std::string HugePageDirectory;
+        /// Advise transparent huge pages for a block in POSIX shared memory, honored if shmem THP is enabled.
+        bool TransparentHugePages {false};
+        /// Fault all pages of the block in when it is mapped, so the first accesses do not take page faults.
+        bool Prefault {false};
+        /// NUMA node to bind the pages of the block to when it is created, -1 means no binding.
+        int NumaNode {-1};
+        /**
+         * @brief Map the block in read-only mode, only used by readers, such as monitoring tools.
+         * @details Read-only readers can not hold slots, pictures are copied under the sequence lock instead.
+         */
+        bool ReadOnly {false};
+    };
+
+    /**
+     * @brief Mapping helper, applying the mapping options to shared memory blocks.
+     */
+    class BlockMapping
+    {
+    public:
+        /// Get the path of the huge page file of the block with the given name.
+        static std::string GetHugePagePath(const MappingOptions& options, const std::string& shared_block_name);
+
+        /**
+         * @brief Create or truncate the huge page file of a block.
+         * @param options Mapping options with the hugetlbfs directory.
+         * @param path Path of the huge page file.
+         * @param size Bytes of the block, rounded up to a multiple of the huge page size.
+         * @throws runtime_error If the directory is not a hugetlbfs mount or the file can not be created.
+         */
+        static void CreateHugePageFile(const MappingOptions& options, const std::string& path, std::size_t size);
+
+        /**
+         * @brief Apply the mapping options to a mapped block.
+         * @param address Address of the mapped block, must be page aligned.
+         * @param size Bytes of the mapped block.
+         * @param options Mapping options to apply.
+         * @param creating Whether the block is just created, only the creator binds it to a NUMA node,
+         *                 and only the creator may prefault it by writing.
+         * @throws runtime_error If failed to bind the block to the NUMA node.
+         * @details Pages are bound before they are prefaulted, so they are allocated on the given node.
+         */
+        static void Prepare(void* address, std::size_t size, const MappingOptions& options, bool creating);
+    };
+}
\ No newline at end of file
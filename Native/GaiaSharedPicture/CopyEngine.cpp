@@ -0,0 +1,95 @@
+#include "CopyEngine.hpp"
+
+#include <algorithm>
+
+namespace Gaia::SharedPicture
+{
+    /// Start the worker threads.
+    CopyEngine::CopyEngine(unsigned int thread_count)
+    {
+        for (unsigned int index = 0; index < thread_count; ++index)
+        {
+            Workers.emplace_back(&CopyEngine::Work, this);
+        }
+    }
+
+    /// Stop and join the worker threads.
+    CopyEngine::~CopyEngine()
+    {
+        {
+            std::unique_lock lock(JobMutex);
+            Stopping = true;
+        }
+        JobCondition.notify_all();
+        for (auto& worker : Workers)
+        {
+            worker.join();
+        }
+    }
+
+    /// Get the engine shared by pictures writers and readers of this process.
+    CopyEngine& CopyEngine::GetDefault()
+    {
+        // Copying is bound by memory bandwidth, which a few threads are enough to saturate.
+        static CopyEngine engine(std::min(3u, std::max(1u, std::thread::hardware_concurrency()) - 1));
+        return engine;
+    }
+
+    /// Run tasks of the current job until all of them are taken.
+    void CopyEngine::RunTasks()
+    {
+        for (auto index = NextTask.fetch_add(1); index < TaskCount; index = NextTask.fetch_add(1))
+        {
+            (*Task)(index);
+        }
+    }
+
+    /// Loop of a worker thread.
+    void CopyEngine::Work()
+    {
+        std::size_t generation = 0;
+        while (true)
+        {
+            {
+                std::unique_lock lock(JobMutex);
+                JobCondition.wait(lock, [&]{ return Stopping || JobGeneration != generation; });
+                if (Stopping) return;
+                generation = JobGeneration;
+            }
+            RunTasks();
+            {
+                std::unique_lock lock(JobMutex);
+                if (--BusyWorkers == 0) DoneCondition.notify_one();
+            }
+        }
+    }
+
+    /// Run tasks on the workers and the calling thread, and wait for all of them to finish.
+    void CopyEngine::Run(std::size_t task_count, const std::function<void(std::size_t)> &task)
+    {
+        if (Workers.empty() || task_count <= 1)
+        {
+            for (std::size_t index = 0; index < task_count; ++index)
+            {
+                task(index);
+            }
+            return;
+        }
+
+        std::unique_lock run_lock(RunMutex);
+        {
+            std::unique_lock lock(JobMutex);
+            Task = &task;
+            TaskCount = task_count;
+            NextTask.store(0);
+            BusyWorkers = Workers.size();
+            ++JobGeneration;
+        }
+        JobCondition.notify_all();
+        RunTasks();
+        // Workers may still be running their last tasks, which reference the task function.
+        std::unique_lock lock(JobMutex);
+        DoneCondition.wait(lock, [&]{ return BusyWorkers == 0; });
+        Task = nullptr;
+    }
+}
\ No newline at end of file
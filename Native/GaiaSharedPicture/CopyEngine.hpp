@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Copy engine running copy bands on a small persistent thread pool.
+     * @details
+     *  Big pictures are split into bands of about the size of a L2 cache,
+     *  which are copied by the workers and the calling thread together.
+     *  Workers sleep between copies, so an idle engine costs no CPU.
+     */
+    class CopyEngine
+    {
+    private:
+        /// Worker threads.
+        std::vector<std::thread> Workers;
+        /// Mutex protecting the job state.
+        std::mutex JobMutex;
+        /// Mutex serializing jobs from different threads.
+        std::mutex RunMutex;
+        /// Condition to wake workers up for a new job or stopping.
+        std::condition_variable JobCondition;
+        /// Condition to notify the caller that all workers have left the job.
+        std::condition_variable DoneCondition;
+        /// Task of the current job.
+        const std::function<void(std::size_t)>* Task {nullptr};
+        /// Count of tasks of the current job.
+        std::size_t TaskCount {0};
+        /// Index of the next task to run.
+        std::atomic<std::size_t> NextTask {0};
+        /// Count of workers still working on the current job.
+        std::size_t BusyWorkers {0};
+        /// Generation of jobs, increased for every job.
+        std::size_t JobGeneration {0};
+        /// Whether workers should stop.
+        bool Stopping {false};
+
+        /// Bytes not lesser than this are copied in parallel.
+        std::atomic<std::size_t> ParallelThreshold {4 << 20};
+        /// Bytes of a band.
+        std::atomic<std::size_t> BandSize {256 << 10};
+
+        /// Loop of a worker thread.
+        void Work();
+        /// Run tasks of the current job until all of them are taken.
+        void RunTasks();
+
+    public:
+        /**
+         * @brief Start the worker threads.
+         * @param thread_count Count of worker threads, the calling thread also works, 0 means no parallelism.
+         */
+        explicit CopyEngine(unsigned int thread_count);
+        /// Stop and join the worker threads.
+        ~CopyEngine();
+
+        CopyEngine(const CopyEngine&) = delete;
+        CopyEngine& operator=(const CopyEngine&) = delete;
+
+        /// Get the engine shared by pictures writers and readers of this process.
+        static CopyEngine& GetDefault();
+
+        /// Get the count of worker threads.
+        [[nodiscard]] inline std::size_t GetThreadCount() const noexcept
+        {
+            return Workers.size();
+        }
+
+        /// Get the bytes from which pictures are copied in parallel.
+        [[nodiscard]] inline std::size_t GetParallelThreshold() const noexcept
+        {
+            return ParallelThreshold.load(std::memory_order_relaxed);
+        }
+        /// Set the bytes from which pictures are copied in parallel.
+        inline void SetParallelThreshold(std::size_t threshold) noexcept
+        {
+            ParallelThreshold.store(threshold, std::memory_order_relaxed);
+        }
+
+        /// Get the bytes of a band.
+        [[nodiscard]] inline std::size_t GetBandSize() const noexcept
+        {
+            return BandSize.load(std::memory_order_relaxed);
+        }
+        /// Set the bytes of a band, it should be about the size of a L2 cache.
+        inline void SetBandSize(std::size_t band_size) noexcept
+        {
+            BandSize.store(band_size > 0 ? band_size : 1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Run tasks on the workers and the calling thread, and wait for all of them to finish.
+         * @param task_count Count of tasks.
+         * @param task Function to run a task with its index.
+         */
+        void Run(std::size_t task_count, const std::function<void(std::size_t)>& task);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "FrameEventLoop.hpp"
+
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace Gaia::SharedPicture
+{
+    /// Create an event loop.
+    FrameEventLoop::FrameEventLoop()
+    {
+        #ifdef __linux__
+        PollDescriptor = ::epoll_create1(EPOLL_CLOEXEC);
+        StopDescriptor = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.fd = StopDescriptor;
+        if (PollDescriptor < 0 || StopDescriptor < 0 ||
+            ::epoll_ctl(PollDescriptor, EPOLL_CTL_ADD, StopDescriptor, &event) != 0)
+        {
+            if (PollDescriptor >= 0) ::close(PollDescriptor);
+            if (StopDescriptor >= 0) ::close(StopDescriptor);
+            throw std::runtime_error("Failed to create frame event loop, failed to create the epoll instance.");
+        }
+        #else
+        throw std::runtime_error("Failed to create frame event loop, it is only supported on Linux.");
+        #endif
+    }
+
+    /// Close the epoll instance.
+    FrameEventLoop::~FrameEventLoop()
+    {
+        #ifdef __linux__
+        ::close(PollDescriptor);
+        ::close(StopDescriptor);
+        #endif
+    }
+
+    /// Call the handler on the loop thread whenever pictures are published to the reader.
+    void FrameEventLoop::Add(PictureReader &reader, Handler handler)
+    {
+        auto descriptor = reader.GetReadinessDescriptor();
+        auto& watch = Watches[descriptor];
+        bool watched = static_cast<bool>(watch);
+        watch = std::make_shared<Watch>(Watch{&reader, std::move(handler)});
+        if (watched) return;
+        #ifdef __linux__
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.fd = descriptor;
+        if (::epoll_ctl(PollDescriptor, EPOLL_CTL_ADD, descriptor, &event) != 0)
+        {
+            Watches.erase(descriptor);
+            throw std::runtime_error("Failed to watch reader, failed to add its readiness descriptor.");
+        }
+        #endif
+    }
+
+    /// Stop watching the reader.
+    void FrameEventLoop::Remove(PictureReader &reader)
+    {
+        auto descriptor = reader.GetReadinessDescriptor();
+        if (Watches.erase(descriptor) == 0) return;
+        #ifdef __linux__
+        ::epoll_ctl(PollDescriptor, EPOLL_CTL_DEL, descriptor, nullptr);
+        #endif
+    }
+
+    /// Wait for published pictures and call the handlers of their readers once.
+    std::size_t FrameEventLoop::RunOnce(std::chrono::milliseconds timeout)
+    {
+        std::size_t count = 0;
+        #ifdef __linux__
+        epoll_event events[64];
+        auto ready = ::epoll_wait(PollDescriptor, events, 64,
+                                  timeout.count() < 0 ? -1 : static_cast<int>(timeout.count()));
+        if (ready < 0 && errno != EINTR)
+        {
+            throw std::runtime_error("Failed to run frame event loop, failed to wait on the epoll instance.");
+        }
+        for (int index = 0; index < ready; ++index)
+        {
+            auto descriptor = events[index].data.fd;
+            if (descriptor == StopDescriptor)
+            {
+                std::uint64_t value;
+                while (::read(StopDescriptor, &value, sizeof(value)) > 0)
+                {}
+                Stopping = true;
+                continue;
+            }
+            auto found = Watches.find(descriptor);
+            // Handlers called before may have removed this watch.
+            if (found == Watches.end()) continue;
+            // Keep the watch alive while its handler is running, for the handler may remove or replace it.
+            auto watch = found->second;
+            watch->Reader->ClearReadiness();
+            watch->Callback(*watch->Reader);
+            ++count;
+        }
+        #else
+        (void)timeout;
+        #endif
+        return count;
+    }
+
+    /// Run the loop until Stop() is called.
+    void FrameEventLoop::Run()
+    {
+        Stopping = false;
+        while (!Stopping)
+        {
+            RunOnce();
+        }
+    }
+
+    /// Stop the running loop.
+    void FrameEventLoop::Stop()
+    {
+        #ifdef __linux__
+        std::uint64_t value = 1;
+        [[maybe_unused]] auto written = ::write(StopDescriptor, &value, sizeof(value));
+        #endif
+    }
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+#include "PictureReader.hpp"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#endif
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Event loop dispatching published pictures of many readers on one thread.
+     * @details
+     *  It waits on the readiness descriptors of the watched readers with epoll, so any count of blocks
+     *  is multiplexed without polling threads. Handlers are called on the thread running the loop,
+     *  after the readiness of their reader is cleared, and usually read with ReadIfNewer() or Dequeue().
+     *  Only supported on Linux.
+     */
+    class FrameEventLoop
+    {
+    public:
+        /// Handler called when pictures are published to the watched reader.
+        using Handler = std::function<void(PictureReader&)>;
+
+    private:
+        /// Watched reader and its handler.
+        struct Watch
+        {
+            PictureReader* Reader;
+            Handler Callback;
+        };
+
+        /// Descriptor of the epoll instance.
+        int PollDescriptor {-1};
+        /// Event descriptor which wakes up the loop to stop it.
+        int StopDescriptor {-1};
+        /// Whether Stop() is called.
+        bool Stopping {false};
+        /// Watched readers, by their readiness descriptors.
+        std::unordered_map<int, std::shared_ptr<Watch>> Watches;
+
+    public:
+        /**
+         * @brief Create an event loop.
+         * @throws runtime_error If the epoll instance can not be created, or the platform is not Linux.
+         */
+        FrameEventLoop();
+        FrameEventLoop(const FrameEventLoop&) = delete;
+        FrameEventLoop& operator=(const FrameEventLoop&) = delete;
+        /// Close the epoll instance, watched readers are not notified anymore.
+        ~FrameEventLoop();
+
+        /**
+         * @brief Call the handler on the loop thread whenever pictures are published to the reader.
+         * @param reader Reader of a ring layout block, which must outlive its watch.
+         * @param handler Handler replacing the previous one if the reader is already watched.
+         * @throws runtime_error Like PictureReader::GetReadinessDescriptor().
+         */
+        void Add(PictureReader& reader, Handler handler);
+        /// Stop watching the reader, it can be called by handlers.
+        void Remove(PictureReader& reader);
+
+        /**
+         * @brief Wait for published pictures and call the handlers of their readers once.
+         * @param timeout Max time to wait, negative to wait until pictures are published or Stop() is called.
+         * @return Count of called handlers.
+         */
+        std::size_t RunOnce(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+        /// Run the loop until Stop() is called.
+        void Run();
+        /// Stop the running loop, it can be called by any thread.
+        void Stop();
+    };
+
+    #if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+    /**
+     * @brief Awaitable of the next picture of a reader dispatched by an event loop, see NextFrame().
+     * @details Only available to C++20 sources; the library itself does not depend on coroutines.
+     */
+    class FrameAwaiter
+    {
+        FrameEventLoop& Loop;
+        PictureReader& Reader;
+        cv::Mat Picture;
+
+        /// Read the next picture, consuming the queue if the block is in the queue mode.
+        bool TryReadNext()
+        {
+            if (Reader.IsQueue())
+            {
+                std::uint64_t dropped;
+                return Reader.Dequeue(Picture, dropped);
+            }
+            return Reader.ReadIfNewer(Picture);
+        }
+
+    public:
+        FrameAwaiter(FrameEventLoop& loop, PictureReader& reader) : Loop(loop), Reader(reader)
+        {}
+
+        bool await_ready()
+        {
+            // Subscribe before reading, so pictures published after the check notify the descriptor.
+            Reader.GetReadinessDescriptor();
+            return TryReadNext();
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            Loop.Add(Reader, [this, handle](PictureReader&){
+                if (!TryReadNext()) return;
+                Loop.Remove(Reader);
+                handle.resume();
+            });
+        }
+
+        cv::Mat await_resume()
+        {
+            return std::move(Picture);
+        }
+    };
+
+    /**
+     * @brief Await the next picture of the reader, copied out like ReadIfNewer(), or consumed like Dequeue().
+     * @details The awaiting coroutine is resumed on the thread running the loop, as in:
+     *  @code cv::Mat picture = co_await NextFrame(loop, reader); @endcode
+     */
+    inline FrameAwaiter NextFrame(FrameEventLoop& loop, PictureReader& reader)
+    {
+        return {loop, reader};
+    }
+    #endif
+}
\ No newline at end of file
@@ -1,7 +1,14 @@
 #pragma once
 
+#include "FrameEventLoop.hpp"
 #include "PictureReader.hpp"
+#include "PictureRecorder.hpp"
+#include "PictureReplayer.hpp"
 #include "PictureWriter.hpp"
+#include "SharedMatAllocator.hpp"
+#include "SharedPictureArena.hpp"
+#include "TypedPictureReader.hpp"
+#include "TypedPictureWriter.hpp"
 
 namespace Gaia::SharedPicture
 {}
\ No newline at end of file
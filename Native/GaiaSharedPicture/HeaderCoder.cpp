@@ -1,52 +1,49 @@
 #include "HeaderCoder.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 #include <opencv2/opencv.hpp>
 
 namespace Gaia::SharedPicture
 {
-    /// Encode a header into bytes.
-    void HeaderCoder::Encode(const PictureHeader &header, unsigned char *buffer)
+    /// Encode the pixel bits and the pixel type into the 2 bytes of the buffer.
+    static void EncodePixelFormat(const PictureHeader &header, unsigned char *buffer)
     {
-        buffer[0] = 0xBE;
         switch (header.PixelBits)
         {
             case PictureHeader::PixelBitSizes::Bits8:
-                buffer[1] = 8;
+                buffer[0] = 8;
                 break;
             case PictureHeader::PixelBitSizes::Bits16:
-                buffer[1] = 16;
+                buffer[0] = 16;
                 break;
             case PictureHeader::PixelBitSizes::Bits32:
-                buffer[1] = 32;
+                buffer[0] = 32;
                 break;
             case PictureHeader::PixelBitSizes::Bits64:
-                buffer[1] = 64;
+                buffer[0] = 64;
                 break;
         }
         switch (header.PixelType)
         {
             case PictureHeader::PixelTypes::Unsigned:
-                buffer[2] = 0;
+                buffer[1] = 0;
                 break;
             case PictureHeader::PixelTypes::Signed:
-                buffer[2] = 1;
+                buffer[1] = 1;
                 break;
             case PictureHeader::PixelTypes::Float:
-                buffer[2] = 2;
+                buffer[1] = 2;
                 break;
         }
-        *(reinterpret_cast<unsigned short*>(&buffer[3])) = header.Channels;
-        *(reinterpret_cast<unsigned short*>(&buffer[5])) = header.Width;
-        *(reinterpret_cast<unsigned short*>(&buffer[7])) = header.Height;
-        buffer[9] = 0xED;
     }
 
-    /// Decode header bytes into a header instance.
-    bool HeaderCoder::Decode(const unsigned char *buffer, PictureHeader &header)
+    /// Decode the pixel bits and the pixel type from the 2 bytes of the buffer.
+    static bool DecodePixelFormat(const unsigned char *buffer, PictureHeader &header)
     {
-        if (buffer[0] != 0xBE || buffer[9] != 0xED) return false;
-
-        switch (buffer[1])
+        switch (buffer[0])
         {
             case 8:
                 header.PixelBits = PictureHeader::PixelBitSizes::Bits8;
@@ -63,7 +60,7 @@ namespace Gaia::SharedPicture
             default:
                 return false;
         }
-        switch (buffer[2])
+        switch (buffer[1])
         {
             case 0:
                 header.PixelType = PictureHeader::PixelTypes::Unsigned;
@@ -77,12 +74,135 @@ namespace Gaia::SharedPicture
             default:
                 return false;
         }
+        return true;
+    }
+
+    /// Encode a header into bytes.
+    void HeaderCoder::Encode(const PictureHeader &header, unsigned char *buffer)
+    {
+        if (header.Dimensions != 2 || header.Channels > 0xFFFF || header.Width > 0xFFFF || header.Height > 0xFFFF)
+        {
+            throw std::runtime_error("Failed to encode header: only 2 dimensions with sizes up to 65535 "
+                                     "are supported by the single layout.");
+        }
+        buffer[0] = 0xBE;
+        EncodePixelFormat(header, &buffer[1]);
+        *(reinterpret_cast<unsigned short*>(&buffer[3])) = static_cast<unsigned short>(header.Channels);
+        *(reinterpret_cast<unsigned short*>(&buffer[5])) = static_cast<unsigned short>(header.Width);
+        *(reinterpret_cast<unsigned short*>(&buffer[7])) = static_cast<unsigned short>(header.Height);
+        buffer[9] = 0xED;
+    }
+
+    /// Decode header bytes into a header instance.
+    bool HeaderCoder::Decode(const unsigned char *buffer, PictureHeader &header)
+    {
+        if (buffer[0] != 0xBE || buffer[9] != 0xED) return false;
+        if (!DecodePixelFormat(&buffer[1], header)) return false;
         header.Channels = *(reinterpret_cast<const unsigned short*>(&buffer[3]));
         header.Width = *(reinterpret_cast<const unsigned short*>(&buffer[5]));
         header.Height = *(reinterpret_cast<const unsigned short*>(&buffer[7]));
+        header.Dimensions = 2;
         return true;
     }
 
+    /// Encode a header into bytes with 32-bit sizes and up to PictureHeader::MaxDimensions dimensions.
+    void HeaderCoder::EncodeExtended(const PictureHeader &header, unsigned char *buffer)
+    {
+        if (header.Dimensions < 2 || header.Dimensions > PictureHeader::MaxDimensions)
+        {
+            throw std::runtime_error("Failed to encode header: unsupported count of dimensions "
+                                     + std::to_string(header.Dimensions) + ".");
+        }
+        buffer[0] = 0xBF;
+        EncodePixelFormat(header, &buffer[1]);
+        buffer[3] = static_cast<unsigned char>(header.Dimensions);
+        std::memcpy(&buffer[4], &header.Channels, 4);
+        auto shape = GetShape(header);
+        for (unsigned int dimension = 0; dimension < PictureHeader::MaxDimensions; ++dimension)
+        {
+            unsigned int size = dimension < shape.size() ? static_cast<unsigned int>(shape[dimension]) : 0;
+            std::memcpy(&buffer[8 + 4 * dimension], &size, 4);
+        }
+        buffer[ExtendedHeaderSize - 1] = 0xED;
+    }
+
+    /// Decode extended header bytes into a header instance.
+    bool HeaderCoder::DecodeExtended(const unsigned char *buffer, PictureHeader &header)
+    {
+        if (buffer[0] != 0xBF || buffer[ExtendedHeaderSize - 1] != 0xED) return false;
+        if (!DecodePixelFormat(&buffer[1], header)) return false;
+        header.Dimensions = buffer[3];
+        if (header.Dimensions < 2 || header.Dimensions > PictureHeader::MaxDimensions) return false;
+        std::memcpy(&header.Channels, &buffer[4], 4);
+        header.Shape.fill(0);
+        for (unsigned int dimension = 0; dimension < header.Dimensions; ++dimension)
+        {
+            std::memcpy(&header.Shape[dimension], &buffer[8 + 4 * dimension], 4);
+            // OpenCV stores sizes of dimensions in int.
+            if (header.Shape[dimension] > 0x7FFFFFFF) return false;
+        }
+        if (header.Dimensions == 2)
+        {
+            header.Height = header.Shape[0];
+            header.Width = header.Shape[1];
+        }
+        else
+        {
+            header.Height = 0;
+            header.Width = 0;
+        }
+        std::size_t picture_size;
+        return header.Channels > 0 && header.Channels <= CV_CN_MAX && GetCheckedPictureSize(header, picture_size);
+    }
+
+    /// Get the sizes of all dimensions from the outermost one.
+    std::vector<int> HeaderCoder::GetShape(const PictureHeader &header)
+    {
+        if (header.Dimensions == 2)
+            return {static_cast<int>(header.Height), static_cast<int>(header.Width)};
+        return std::vector<int>(header.Shape.begin(), header.Shape.begin() +
+            std::min(header.Dimensions, PictureHeader::MaxDimensions));
+    }
+
+    /// Get the bytes of a row, which is the innermost dimension, without padding.
+    std::size_t HeaderCoder::GetRowSize(const PictureHeader &header)
+    {
+        auto shape = GetShape(header);
+        return static_cast<std::size_t>(shape.back()) * GetPixelSize(header);
+    }
+
+    /// Get the count of rows, which is the product of sizes of all dimensions except the innermost one.
+    std::size_t HeaderCoder::GetRowCount(const PictureHeader &header)
+    {
+        auto shape = GetShape(header);
+        std::size_t count = 1;
+        for (std::size_t dimension = 0; dimension + 1 < shape.size(); ++dimension)
+        {
+            count *= static_cast<std::size_t>(shape[dimension]);
+        }
+        return count;
+    }
+
+    /// Construct a picture on the given bytes without copying.
+    cv::Mat HeaderCoder::GetPicture(const PictureHeader &header, void *data, std::size_t row_stride)
+    {
+        if (header.Dimensions == 2)
+        {
+            return cv::Mat(cv::Size(static_cast<int>(header.Width), static_cast<int>(header.Height)),
+                           GetCVPixelType(header), data, row_stride);
+        }
+        auto shape = GetShape(header);
+        if (row_stride == cv::Mat::AUTO_STEP) row_stride = GetRowSize(header);
+        // Steps of all dimensions except the innermost one, whose step is the pixel size.
+        std::vector<std::size_t> steps(shape.size() - 1);
+        steps.back() = row_stride;
+        for (auto dimension = static_cast<int>(steps.size()) - 2; dimension >= 0; --dimension)
+        {
+            steps[dimension] = steps[dimension + 1] * shape[dimension + 1];
+        }
+        return cv::Mat(static_cast<int>(shape.size()), shape.data(), GetCVPixelType(header), data, steps.data());
+    }
+
     /// Convert the pixel type in header into an OpenCV pixel type.
     int HeaderCoder::GetCVPixelType(const PictureHeader &header)
     {
@@ -145,13 +265,60 @@ namespace Gaia::SharedPicture
         return pixel_type;
     }
 
+    /// Calculate the bytes of a pixel described by the header.
+    std::size_t HeaderCoder::GetPixelSize(const PictureHeader &header)
+    {
+        std::size_t byte_scale_factor = 1;
+        switch (header.PixelBits)
+        {
+            case PictureHeader::PixelBitSizes::Bits8:
+                byte_scale_factor = 1;
+                break;
+            case PictureHeader::PixelBitSizes::Bits16:
+                byte_scale_factor = 2;
+                break;
+            case PictureHeader::PixelBitSizes::Bits32:
+                byte_scale_factor = 4;
+                break;
+            case PictureHeader::PixelBitSizes::Bits64:
+                byte_scale_factor = 8;
+                break;
+        }
+        return header.Channels * byte_scale_factor;
+    }
+
+    /// Calculate the bytes of the picture described by the header.
+    std::size_t HeaderCoder::GetPictureSize(const PictureHeader &header)
+    {
+        return GetRowCount(header) * GetRowSize(header);
+    }
+
+    /// Calculate the bytes of the picture described by the header, failing instead of overflowing.
+    bool HeaderCoder::GetCheckedPictureSize(const PictureHeader &header, std::size_t &size)
+    {
+        size = GetPixelSize(header);
+        for (auto dimension : GetShape(header))
+        {
+            auto extent = static_cast<std::size_t>(dimension);
+            if (extent != 0 && size > std::numeric_limits<std::size_t>::max() / extent) return false;
+            size *= extent;
+        }
+        return true;
+    }
+
     /// Get the header from a cv::Mat.
     PictureHeader HeaderCoder::GetHeader(const cv::Mat &picture)
+    {
+        return GetHeader(picture.type(), picture.dims, picture.size.p);
+    }
+
+    /// Get the header of a picture with the given OpenCV pixel type and sizes.
+    PictureHeader HeaderCoder::GetHeader(int type, int dimensions, const int* sizes)
     {
         PictureHeader header;
 
         // Code generated from python.
-        switch (picture.type())
+        switch (type)
         {
             case CV_8UC1:
                 header.PixelBits = PictureHeader::PixelBitSizes::Bits8;
@@ -314,8 +481,23 @@ namespace Gaia::SharedPicture
                 header.Channels = 4;
                 break;
         }
-        header.Width = picture.cols;
-        header.Height = picture.rows;
+        if (dimensions > 2)
+        {
+            if (dimensions > static_cast<int>(PictureHeader::MaxDimensions))
+            {
+                throw std::runtime_error("Failed to get header: picture has more than "
+                                         + std::to_string(PictureHeader::MaxDimensions) + " dimensions.");
+            }
+            header.Dimensions = dimensions;
+            for (int dimension = 0; dimension < dimensions; ++dimension)
+            {
+                header.Shape[dimension] = sizes[dimension];
+            }
+            return header;
+        }
+        // Empty pictures have no dimensions.
+        header.Width = dimensions == 2 ? sizes[1] : 0;
+        header.Height = dimensions == 2 ? sizes[0] : 0;
 
         return header;
     }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <opencv2/opencv.hpp>
 
@@ -23,11 +24,23 @@ namespace Gaia::SharedPicture
             Float
         } PixelType {PixelTypes::Unsigned};
         /// Counts of channels.
-        unsigned short Channels {3};
+        unsigned int Channels {3};
         /// Width of the picture.
-        unsigned short Width {0};
+        unsigned int Width {0};
         /// Height of the picture.
-        unsigned short Height {0};
+        unsigned int Height {0};
+
+        /// Max count of dimensions.
+        static constexpr unsigned int MaxDimensions = 8;
+        /**
+         * @brief Count of dimensions.
+         * @details
+         *  A 2-dimensional picture is described by Height and Width,
+         *  a picture with more dimensions, such as a batch of pictures, is described by Shape.
+         */
+        unsigned int Dimensions {2};
+        /// Sizes of dimensions from the outermost one, only used if there are more than 2 dimensions.
+        std::array<unsigned int, MaxDimensions> Shape {};
     };
 
     /**
@@ -36,9 +49,15 @@ namespace Gaia::SharedPicture
     class HeaderCoder
     {
     public:
+        /// Bytes of an encoded header.
+        static constexpr std::size_t HeaderSize = 10;
+        /// Bytes of an encoded extended header.
+        static constexpr std::size_t ExtendedHeaderSize = 8 + 4 * PictureHeader::MaxDimensions + 1;
+
         /**
          * @brief Encode a header into bytes.
          * @param buffer Buffer to store encoded header information, must not be lesser than 10 bytes.
+         * @throws runtime_error If the header has more than 2 dimensions, or any size is bigger than 65535.
          */
         static void Encode(const PictureHeader& header, unsigned char* buffer);
         /**
@@ -47,6 +66,37 @@ namespace Gaia::SharedPicture
          */
         static bool Decode(const unsigned char* buffer, PictureHeader& header);
 
+        /**
+         * @brief Encode a header into bytes with 32-bit sizes and up to PictureHeader::MaxDimensions dimensions.
+         * @param buffer Buffer to store encoded header information, must not be lesser than ExtendedHeaderSize.
+         * @throws runtime_error If the header has more than PictureHeader::MaxDimensions dimensions.
+         */
+        static void EncodeExtended(const PictureHeader& header, unsigned char* buffer);
+        /**
+         * @brief Decode extended header bytes into a header instance.
+         * @param buffer Buffer with the encoded information to decode, must not be lesser than ExtendedHeaderSize.
+         * @details Headers whose picture bytes do not fit in std::size_t fail to decode,
+         *          so sizes of decoded headers can be multiplied without overflow checks.
+         */
+        static bool DecodeExtended(const unsigned char* buffer, PictureHeader& header);
+
+        /// Get the sizes of all dimensions from the outermost one, {Height, Width} for a 2-dimensional picture.
+        static std::vector<int> GetShape(const PictureHeader& header);
+
+        /// Get the bytes of a row, which is the innermost dimension, without padding.
+        static std::size_t GetRowSize(const PictureHeader& header);
+        /// Get the count of rows, which is the product of sizes of all dimensions except the innermost one.
+        static std::size_t GetRowCount(const PictureHeader& header);
+
+        /**
+         * @brief Construct a picture on the given bytes without copying.
+         * @param header Header of the picture.
+         * @param data Address of the picture bytes.
+         * @param row_stride Bytes between the beginnings of two adjacent rows, cv::Mat::AUTO_STEP if not padded.
+         */
+        static cv::Mat GetPicture(const PictureHeader& header, void* data,
+                                  std::size_t row_stride = cv::Mat::AUTO_STEP);
+
         /**
          * @brief Convert the pixel type in header into an OpenCV pixel type.
          * @param header Header of the picture.
@@ -54,8 +104,37 @@ namespace Gaia::SharedPicture
          */
         static int GetCVPixelType(const PictureHeader& header);
 
+        /**
+         * @brief Calculate the bytes of a pixel described by the header, all channels included.
+         * @param header Header of the picture.
+         * @return Bytes of a pixel.
+         */
+        static std::size_t GetPixelSize(const PictureHeader& header);
+
+        /**
+         * @brief Calculate the bytes of the picture described by the header.
+         * @param header Header of the picture.
+         * @return Bytes of the pixels of the picture.
+         */
+        static std::size_t GetPictureSize(const PictureHeader& header);
+        /**
+         * @brief Calculate the bytes of the picture described by the header, failing instead of overflowing.
+         * @param header Header of the picture, such as one from another process or peer.
+         * @param size Bytes of the pixels of the picture.
+         * @retval false The count of elements or the bytes of the picture do not fit in std::size_t.
+         */
+        static bool GetCheckedPictureSize(const PictureHeader& header, std::size_t& size);
+
         /// Get the header from a cv::Mat.
         static PictureHeader GetHeader(const cv::Mat& picture);
+        /**
+         * @brief Get the header of a picture with the given OpenCV pixel type and sizes, such as one to allocate.
+         * @param type OpenCV pixel type.
+         * @param dimensions Count of dimensions.
+         * @param sizes Sizes of all dimensions from the outermost one.
+         * @throws runtime_error If there are more than PictureHeader::MaxDimensions dimensions.
+         */
+        static PictureHeader GetHeader(int type, int dimensions, const int* sizes);
     };
 
 
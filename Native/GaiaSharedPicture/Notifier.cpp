@@ -0,0 +1,52 @@
+#include "Notifier.hpp"
+
+#include <thread>
+
+#ifdef __linux__
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Gaia::SharedPicture
+{
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+            "Notification word must have the same layout as a 32-bit integer.");
+
+    /// Wait until the word is no longer the expected value, or the timeout is reached.
+    bool Notifier::Wait(std::atomic<std::uint32_t> &word, std::uint32_t expected, std::chrono::microseconds timeout)
+    {
+        if (word.load() != expected) return true;
+        if (timeout.count() <= 0) return false;
+        #ifdef __linux__
+        timespec relative_timeout {};
+        relative_timeout.tv_sec = static_cast<time_t>(timeout.count() / 1000000);
+        relative_timeout.tv_nsec = static_cast<long>(timeout.count() % 1000000 * 1000);
+        // Not a private futex, for the word is shared between processes.
+        auto result = syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT,
+                              expected, &relative_timeout, nullptr, 0);
+        return !(result == -1 && errno == ETIMEDOUT);
+        #else
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (word.load() == expected)
+        {
+            if (std::chrono::steady_clock::now() >= deadline) return false;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        return true;
+        #endif
+    }
+
+    /// Wake all processes waiting on the word.
+    void Notifier::WakeAll(std::atomic<std::uint32_t> &word)
+    {
+        #ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        #else
+        (void)word;
+        #endif
+    }
+}
\ No newline at end of file
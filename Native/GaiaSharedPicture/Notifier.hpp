@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Process-shared notification on a 32-bit word in shared memory.
+     * @details
+     *  On Linux it is backed by a shared futex, so waiting costs no CPU and waking costs one system call;
+     *  on other systems waiting falls back to polling the word with short sleeps.
+     */
+    class Notifier
+    {
+    public:
+        /**
+         * @brief Wait until the word is no longer the expected value, or the timeout is reached.
+         * @param word Notification word in shared memory.
+         * @param expected Value of the word which means nothing happened.
+         * @param timeout Max time to wait.
+         * @retval true The word may have been changed, spurious wakeups are possible.
+         * @retval false Timeout is reached.
+         */
+        static bool Wait(std::atomic<std::uint32_t>& word, std::uint32_t expected, std::chrono::microseconds timeout);
+
+        /// Wake all processes waiting on the word.
+        static void WakeAll(std::atomic<std::uint32_t>& word);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "PayloadCodec.hpp"
+
+#include <type_traits>
+
+namespace Gaia::SharedPicture
+{
+    /// Max bytes of a varint of 64 bits.
+    constexpr std::size_t MaxVarintSize = 10;
+
+    /// Write a varint, the caller must make sure that MaxVarintSize bytes are available.
+    static inline void WriteVarint(unsigned char*& position, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            *position++ = static_cast<unsigned char>(value | 0x80);
+            value >>= 7;
+        }
+        *position++ = static_cast<unsigned char>(value);
+    }
+
+    /// Read a varint, return false if it exceeds the end or is longer than MaxVarintSize bytes.
+    static inline bool ReadVarint(const unsigned char*& position, const unsigned char* end, std::uint64_t& value)
+    {
+        value = 0;
+        for (unsigned int shift = 0; shift < MaxVarintSize * 7 && position < end; shift += 7)
+        {
+            auto byte = *position++;
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief View a picture as rows of samples of its innermost dimension.
+     * @return False if the rows of the picture are not evenly strided.
+     */
+    static bool GetSampleRows(const cv::Mat& picture, std::size_t& rows, std::size_t& row_stride)
+    {
+        rows = picture.total() / static_cast<std::size_t>(picture.size[picture.dims - 1]);
+        row_stride = picture.dims > 1 ? picture.step[picture.dims - 2] : picture.step[0];
+        for (int dimension = 0; dimension + 2 < picture.dims; ++dimension)
+        {
+            if (picture.step[dimension] != picture.step[dimension + 1] * picture.size[dimension + 1]) return false;
+        }
+        return true;
+    }
+
+    /// Encode rows of samples of the given type.
+    template <typename Sample>
+    static std::size_t EncodeRows(const unsigned char* data, std::size_t rows, std::size_t row_stride,
+                                  std::size_t samples, std::size_t distance,
+                                  unsigned char* destination, std::size_t capacity)
+    {
+        using SignedSample = std::make_signed_t<Sample>;
+        auto* position = destination;
+        auto* limit = capacity >= MaxVarintSize ? destination + capacity - MaxVarintSize : destination;
+        for (std::size_t row = 0; row < rows; ++row)
+        {
+            const auto* sample = reinterpret_cast<const Sample*>(data + row * row_stride);
+            std::uint64_t zero_run = 0;
+            for (std::size_t index = 0; index < samples; ++index)
+            {
+                auto delta = static_cast<Sample>(sample[index] - (index >= distance ? sample[index - distance] : 0));
+                if (delta == 0)
+                {
+                    ++zero_run;
+                    continue;
+                }
+                if (position >= limit) return 0;
+                if (zero_run > 0)
+                {
+                    WriteVarint(position, zero_run << 1 | 1);
+                    zero_run = 0;
+                    if (position >= limit) return 0;
+                }
+                auto signed_delta = static_cast<std::int64_t>(static_cast<SignedSample>(delta));
+                auto zigzag = static_cast<std::uint64_t>(signed_delta) << 1 ^
+                              static_cast<std::uint64_t>(signed_delta >> 63);
+                WriteVarint(position, zigzag << 1);
+            }
+            if (zero_run > 0)
+            {
+                if (position >= limit) return 0;
+                WriteVarint(position, zero_run << 1 | 1);
+            }
+        }
+        return static_cast<std::size_t>(position - destination);
+    }
+
+    /// Decode rows of samples of the given type.
+    template <typename Sample>
+    static bool DecodeRows(const unsigned char* source, std::size_t size, unsigned char* data, std::size_t rows,
+                           std::size_t row_stride, std::size_t samples, std::size_t distance)
+    {
+        const auto* position = source;
+        const auto* end = source + size;
+        for (std::size_t row = 0; row < rows; ++row)
+        {
+            auto* sample = reinterpret_cast<Sample*>(data + row * row_stride);
+            std::size_t index = 0;
+            while (index < samples)
+            {
+                std::uint64_t token;
+                if (!ReadVarint(position, end, token)) return false;
+                if (token & 1)
+                {
+                    auto run = token >> 1;
+                    if (run == 0 || run > samples - index) return false;
+                    for (auto run_end = index + run; index < run_end; ++index)
+                    {
+                        sample[index] = index >= distance ? sample[index - distance] : 0;
+                    }
+                    continue;
+                }
+                auto zigzag = token >> 1;
+                auto delta = static_cast<Sample>(zigzag >> 1 ^ (~(zigzag & 1) + 1));
+                sample[index] = static_cast<Sample>((index >= distance ? sample[index - distance] : 0) + delta);
+                ++index;
+            }
+        }
+        return position == end;
+    }
+
+    /// Encode a picture with the delta and run length codec.
+    std::size_t PayloadCodec::Encode(const cv::Mat &picture, unsigned char *destination, std::size_t capacity)
+    {
+        if (picture.empty()) return 0;
+        std::size_t rows, row_stride;
+        if (!GetSampleRows(picture, rows, row_stride)) return Encode(picture.clone(), destination, capacity);
+        auto channels = static_cast<std::size_t>(picture.channels());
+        auto samples = static_cast<std::size_t>(picture.size[picture.dims - 1]) * channels;
+        switch (picture.elemSize1())
+        {
+            case 1:
+                return EncodeRows<std::uint8_t>(picture.data, rows, row_stride, samples, channels,
+                                                destination, capacity);
+            case 2:
+                return EncodeRows<std::uint16_t>(picture.data, rows, row_stride, samples, channels,
+                                                 destination, capacity);
+            case 4:
+                return EncodeRows<std::uint32_t>(picture.data, rows, row_stride, samples, channels,
+                                                 destination, capacity);
+            default:
+                // 64-bit samples are encoded as pairs of 32-bit halves.
+                return EncodeRows<std::uint32_t>(picture.data, rows, row_stride, samples * 2, channels * 2,
+                                                 destination, capacity);
+        }
+    }
+
+    /// Decode a picture encoded by Encode().
+    bool PayloadCodec::Decode(const unsigned char *source, std::size_t size, cv::Mat &picture)
+    {
+        if (picture.empty()) return false;
+        std::size_t rows, row_stride;
+        if (!GetSampleRows(picture, rows, row_stride)) return false;
+        auto channels = static_cast<std::size_t>(picture.channels());
+        auto samples = static_cast<std::size_t>(picture.size[picture.dims - 1]) * channels;
+        switch (picture.elemSize1())
+        {
+            case 1:
+                return DecodeRows<std::uint8_t>(source, size, picture.data, rows, row_stride, samples, channels);
+            case 2:
+                return DecodeRows<std::uint16_t>(source, size, picture.data, rows, row_stride, samples, channels);
+            case 4:
+                return DecodeRows<std::uint32_t>(source, size, picture.data, rows, row_stride, samples, channels);
+            default:
+                return DecodeRows<std::uint32_t>(source, size, picture.data, rows, row_stride,
+                                                 samples * 2, channels * 2);
+        }
+    }
+}
\ No newline at end of file
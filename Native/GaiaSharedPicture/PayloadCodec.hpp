@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+namespace Gaia::SharedPicture
+{
+    /// Codecs of the picture bytes in a ring layout slot.
+    enum class PayloadCodecs : std::uint32_t
+    {
+        /// Picture bytes are stored as they are, rows may be padded to the row stride.
+        Raw = 0,
+        /**
+         * Every sample is replaced by its difference from the same channel of the previous pixel in its row,
+         * runs of zero differences are stored as run lengths, and other differences as zigzag varints.
+         * It is lossless and suits depth maps and masks.
+         */
+        DeltaRle = 1
+    };
+
+    /**
+     * @brief Payload codec, encoding pictures into slots and decoding them into caller owned pictures.
+     */
+    class PayloadCodec
+    {
+    public:
+        /**
+         * @brief Encode a picture with the delta and run length codec.
+         * @param picture Picture to encode.
+         * @param destination Address to write the encoded bytes to.
+         * @param capacity Max bytes to write.
+         * @return Bytes of the encoded picture, or 0 if they would exceed the capacity.
+         */
+        static std::size_t Encode(const cv::Mat& picture, unsigned char* destination, std::size_t capacity);
+
+        /**
+         * @brief Decode a picture encoded by Encode().
+         * @param source Address of the encoded bytes.
+         * @param size Bytes of the encoded picture.
+         * @param picture Picture to decode into, which must be allocated with the shape and type of the encoded one.
+         * @retval true Successfully decoded.
+         * @retval false The encoded bytes are broken, such as being overwritten while decoding.
+         * @details Broken bytes never make it read or write out of bounds.
+         */
+        static bool Decode(const unsigned char* source, std::size_t size, cv::Mat& picture);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "PictureConverter.hpp"
+#include "CopyEngine.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Convert a row of a picture into the target channels.
+     * @param source First pixel of the source row.
+     * @param columns Count of pixels in the row.
+     * @param channels Count of channels.
+     * @param order Source channel of every target channel.
+     * @param scale Scale of every target channel.
+     * @param offset Offset of every target channel.
+     * @param targets First element of every target channel in the row.
+     * @param target_stride Elements between two adjacent pixels of a target channel.
+     */
+    template <typename Source, typename Target>
+    static void ConvertRow(const Source* source, int columns, int channels, const int* order,
+                           const float* scale, const float* offset, Target* const* targets, std::size_t target_stride)
+    {
+        for (int channel = 0; channel < channels; ++channel)
+        {
+            const auto* origin = source + order[channel];
+            auto* target = targets[channel];
+            auto channel_scale = scale[channel];
+            auto channel_offset = offset[channel];
+            for (int column = 0; column < columns; ++column)
+            {
+                target[column * target_stride] = cv::saturate_cast<Target>(
+                        static_cast<float>(origin[column * channels]) * channel_scale + channel_offset);
+            }
+        }
+    }
+
+    /// Convert a row of an 8-bit picture into the target channels through lookup tables of 256 entries per channel.
+    template <typename Target>
+    static void ConvertTableRow(const std::uint8_t* source, int columns, int channels, const int* order,
+                                const Target* table, Target* const* targets, std::size_t target_stride)
+    {
+        for (int channel = 0; channel < channels; ++channel)
+        {
+            const auto* origin = source + order[channel];
+            const auto* channel_table = table + channel * 256;
+            auto* target = targets[channel];
+            for (int column = 0; column < columns; ++column)
+            {
+                target[column * target_stride] = channel_table[origin[column * channels]];
+            }
+        }
+    }
+
+    /// Convert all rows of a picture into an allocated destination, in parallel bands for big pictures.
+    template <typename Source, typename Target>
+    static void ConvertRows(const cv::Mat& source, cv::Mat& destination, const ConversionFormat& format,
+                            const int* order)
+    {
+        auto channels = source.channels();
+        auto rows = source.rows;
+        auto columns = source.cols;
+        float scale[4], offset[4];
+        for (int channel = 0; channel < 4; ++channel)
+        {
+            scale[channel] = static_cast<float>(format.Scale[channel]);
+            offset[channel] = static_cast<float>(format.Offset[channel]);
+        }
+        std::vector<Target> table;
+        if constexpr (std::is_same_v<Source, std::uint8_t>)
+        {
+            table.resize(static_cast<std::size_t>(channels) * 256);
+            for (int channel = 0; channel < channels; ++channel)
+            {
+                for (int value = 0; value < 256; ++value)
+                {
+                    table[channel * 256 + value] = cv::saturate_cast<Target>(
+                            static_cast<float>(value) * scale[channel] + offset[channel]);
+                }
+            }
+        }
+
+        auto row_size = static_cast<std::size_t>(columns) * channels * sizeof(Target);
+        auto& engine = CopyEngine::GetDefault();
+        bool parallel = row_size * static_cast<std::size_t>(rows) >= engine.GetParallelThreshold();
+        auto band_rows = parallel ? std::max<std::size_t>(1, engine.GetBandSize() / std::max<std::size_t>(1, row_size))
+                                  : std::max<std::size_t>(1, rows);
+        std::size_t target_stride = format.Planar ? 1 : channels;
+        engine.Run((rows + band_rows - 1) / band_rows, [&](std::size_t band){
+            auto end = std::min<std::size_t>(rows, (band + 1) * band_rows);
+            for (auto row = band * band_rows; row < end; ++row)
+            {
+                Target* targets[4];
+                for (int channel = 0; channel < channels; ++channel)
+                {
+                    if (format.Planar)
+                        targets[channel] = reinterpret_cast<Target*>(
+                                destination.data + channel * destination.step[0] + row * destination.step[1]);
+                    else
+                        targets[channel] = reinterpret_cast<Target*>(destination.data + row * destination.step[0])
+                                           + channel;
+                }
+                const auto* origin = reinterpret_cast<const Source*>(source.data + row * source.step[0]);
+                if constexpr (std::is_same_v<Source, std::uint8_t>)
+                    ConvertTableRow(origin, columns, channels, order, table.data(), targets, target_stride);
+                else
+                    ConvertRow(origin, columns, channels, order, scale, offset, targets, target_stride);
+            }
+        });
+    }
+
+    /// Convert all rows of a picture with the given source element type into the target depth.
+    template <typename Source>
+    static void ConvertSource(const cv::Mat& source, cv::Mat& destination, const ConversionFormat& format,
+                              const int* order)
+    {
+        switch (format.Depth)
+        {
+            case CV_8U:
+                ConvertRows<Source, std::uint8_t>(source, destination, format, order);
+                break;
+            case CV_16U:
+                ConvertRows<Source, std::uint16_t>(source, destination, format, order);
+                break;
+            default:
+                ConvertRows<Source, float>(source, destination, format, order);
+                break;
+        }
+    }
+
+    /// Convert a picture into the target format.
+    void PictureConverter::Convert(const cv::Mat &source, cv::Mat &destination, const ConversionFormat &format)
+    {
+        if (source.empty())
+        {
+            destination.release();
+            return;
+        }
+        auto channels = source.channels();
+        if (source.dims != 2 || channels > 4)
+            throw std::runtime_error("Failed to convert picture: only 2-dimensional pictures "
+                                     "with up to 4 channels can be converted.");
+        if (format.Depth != CV_8U && format.Depth != CV_16U && format.Depth != CV_32F)
+            throw std::runtime_error("Failed to convert picture: the target depth is not supported.");
+        if (format.ReverseChannels && channels < 3)
+            throw std::runtime_error("Failed to convert picture: channels of a picture with less than 3 channels "
+                                     "can not be reversed.");
+
+        int order[4] = {0, 1, 2, 3};
+        if (format.ReverseChannels) std::swap(order[0], order[2]);
+        if (format.Planar)
+        {
+            int shape[3] = {channels, source.rows, source.cols};
+            destination.create(3, shape, format.Depth);
+        }
+        else
+            destination.create(source.rows, source.cols, CV_MAKETYPE(format.Depth, channels));
+
+        switch (source.depth())
+        {
+            case CV_8U:
+                ConvertSource<std::uint8_t>(source, destination, format, order);
+                break;
+            case CV_16U:
+                ConvertSource<std::uint16_t>(source, destination, format, order);
+                break;
+            case CV_32F:
+                ConvertSource<float>(source, destination, format, order);
+                break;
+            default:
+                throw std::runtime_error("Failed to convert picture: the source depth is not supported.");
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Target format of a picture converted on read, such as the input format of an inference model.
+     * @details Every channel of the target is computed as source channel * scale + offset.
+     */
+    struct ConversionFormat
+    {
+        /// Whether to reverse the order of the first 3 channels, such as BGR to RGB, the alpha channel is kept.
+        bool ReverseChannels {false};
+        /// Depth of the target picture, CV_8U, CV_16U or CV_32F.
+        int Depth {CV_32F};
+        /// Scale of every target channel, applied after reordering channels.
+        cv::Scalar Scale {1.0, 1.0, 1.0, 1.0};
+        /// Offset of every target channel, added after scaling.
+        cv::Scalar Offset {0.0, 0.0, 0.0, 0.0};
+        /**
+         * @brief Whether the target picture is planar or interleaved.
+         * @details
+         *  A planar target of a H x W picture with C channels is a single channel picture of C x H x W,
+         *  an interleaved target is a H x W picture with C channels.
+         */
+        bool Planar {false};
+    };
+
+    /**
+     * @brief Picture converter converting pixel formats in one pass, fusing channel reordering,
+     *        depth conversion with scaling and the layout change between interleaved and planar.
+     * @details
+     *  Pictures are converted row by row, so every row is read once and is still in the cache
+     *  when its channels are written; 8-bit pictures are converted through per-channel lookup tables.
+     *  Big pictures are converted in bands of rows by the default CopyEngine.
+     */
+    class PictureConverter
+    {
+    public:
+        /**
+         * @brief Convert a picture into the target format.
+         * @param source Picture of 2 dimensions with 1 to 4 channels of depth CV_8U, CV_16U or CV_32F.
+         * @param destination Caller owned picture to convert into, its buffer is reused if it has the same shape and type.
+         * @param format Target format.
+         * @throws runtime_error If the source picture or the target format is not supported.
+         */
+        static void Convert(const cv::Mat& source, cv::Mat& destination, const ConversionFormat& format);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "PictureCopier.hpp"
+#include "CopyEngine.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GAIA_SHARED_PICTURE_STREAMING_STORE
+#endif
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief View a picture as rows of its innermost dimension.
+     * @param picture Picture to view.
+     * @param rows Count of rows.
+     * @param row_stride Bytes between the beginnings of two adjacent rows.
+     * @retval true All rows are evenly strided.
+     * @retval false Outer dimensions of the picture are not evenly strided, such as an N-dimensional ROI.
+     */
+    static bool GetRows(const cv::Mat& picture, std::size_t& rows, std::size_t& row_stride)
+    {
+        rows = 1;
+        for (int dimension = 0; dimension + 1 < picture.dims; ++dimension)
+        {
+            rows *= static_cast<std::size_t>(picture.size[dimension]);
+        }
+        row_stride = picture.dims > 1 ? picture.step[picture.dims - 2] : picture.step[0];
+        for (int dimension = 0; dimension + 2 < picture.dims; ++dimension)
+        {
+            if (picture.step[dimension] != picture.step[dimension + 1] * picture.size[dimension + 1]) return false;
+        }
+        return true;
+    }
+
+    /// Copy bytes between non-overlapping buffers.
+    void PictureCopier::CopyBytes(void *destination, const void *source, std::size_t size, bool streaming)
+    {
+        #ifdef GAIA_SHARED_PICTURE_STREAMING_STORE
+        if (streaming && size >= 64)
+        {
+            auto* target = static_cast<unsigned char*>(destination);
+            const auto* origin = static_cast<const unsigned char*>(source);
+            // Copy the head to make the destination aligned for the streaming stores.
+            auto head = (16 - reinterpret_cast<std::uintptr_t>(target) % 16) % 16;
+            std::memcpy(target, origin, head);
+            target += head;
+            origin += head;
+            size -= head;
+            auto blocks = size / 64;
+            for (std::size_t block = 0; block < blocks; ++block)
+            {
+                auto first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(origin));
+                auto second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(origin + 16));
+                auto third = _mm_loadu_si128(reinterpret_cast<const __m128i*>(origin + 32));
+                auto fourth = _mm_loadu_si128(reinterpret_cast<const __m128i*>(origin + 48));
+                _mm_stream_si128(reinterpret_cast<__m128i*>(target), first);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(target + 16), second);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(target + 32), third);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(target + 48), fourth);
+                target += 64;
+                origin += 64;
+            }
+            std::memcpy(target, origin, size % 64);
+            // Streaming stores are weakly ordered, they must be visible before the picture is published.
+            _mm_sfence();
+            return;
+        }
+        #else
+        (void)streaming;
+        #endif
+        std::memcpy(destination, source, size);
+    }
+
+    /// Copy a picture into a destination picture with the same shape and type.
+    void PictureCopier::Copy(const cv::Mat &source, cv::Mat &destination)
+    {
+        if (source.type() != destination.type() || source.dims != destination.dims)
+            throw std::runtime_error("Failed to copy picture: pictures differ in type or dimensions.");
+        for (int dimension = 0; dimension < source.dims; ++dimension)
+        {
+            if (source.size[dimension] != destination.size[dimension])
+                throw std::runtime_error("Failed to copy picture: pictures differ in shape.");
+        }
+
+        auto picture_size = source.total() * source.elemSize();
+        bool streaming = picture_size >= StreamingThreshold;
+        auto& engine = CopyEngine::GetDefault();
+        bool parallel = picture_size >= engine.GetParallelThreshold();
+        auto band_size = engine.GetBandSize();
+        if (source.isContinuous() && destination.isContinuous())
+        {
+            if (!parallel)
+            {
+                CopyBytes(destination.data, source.data, picture_size, streaming);
+                return;
+            }
+            // Bands are aligned to cache lines, so no cache line is written by two threads.
+            band_size = std::max<std::size_t>(64, band_size / 64 * 64);
+            engine.Run((picture_size + band_size - 1) / band_size, [&](std::size_t band){
+                auto offset = band * band_size;
+                CopyBytes(destination.data + offset, source.data + offset,
+                          std::min(band_size, picture_size - offset), streaming);
+            });
+            return;
+        }
+
+        std::size_t rows, source_stride, destination_stride;
+        if (!GetRows(source, rows, source_stride) || !GetRows(destination, rows, destination_stride))
+        {
+            source.copyTo(destination);
+            return;
+        }
+        auto row_size = static_cast<std::size_t>(source.size[source.dims - 1]) * source.elemSize();
+        auto band_rows = parallel ? std::max<std::size_t>(1, band_size / std::max<std::size_t>(1, row_size))
+                                  : std::max<std::size_t>(1, rows);
+        engine.Run((rows + band_rows - 1) / band_rows, [&](std::size_t band){
+            auto end = std::min(rows, (band + 1) * band_rows);
+            for (auto row = band * band_rows; row < end; ++row)
+            {
+                CopyBytes(destination.data + row * destination_stride, source.data + row * source_stride,
+                          row_size, streaming);
+            }
+        });
+    }
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <opencv2/opencv.hpp>
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Picture copier providing the copy paths used to write pictures into shared memory.
+     * @details
+     *  Continuous pictures are copied in one bulk copy, using non-temporal stores for big pictures
+     *  to avoid evicting the cache of the writer with bytes it will never read again;
+     *  pictures with strided rows, such as ROIs or padded slots, are copied row by row in parallel.
+     */
+    class PictureCopier
+    {
+    public:
+        /// Pictures not lesser than this bytes are copied with non-temporal stores.
+        static constexpr std::size_t StreamingThreshold = 1 << 20;
+
+        /**
+         * @brief Copy bytes between non-overlapping buffers.
+         * @param destination Address to copy to.
+         * @param source Address to copy from.
+         * @param size Bytes to copy.
+         * @param streaming Whether to use non-temporal stores, ignored if the CPU does not support them.
+         */
+        static void CopyBytes(void* destination, const void* source, std::size_t size, bool streaming);
+
+        /**
+         * @brief Copy a picture into a destination picture with the same shape and type without reallocating it.
+         * @param source Picture to copy from.
+         * @param destination Picture to copy into, such as a picture mapped onto shared memory.
+         * @throws runtime_error If the pictures differ in shape or type.
+         */
+        static void Copy(const cv::Mat& source, cv::Mat& destination);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "PictureDownsampler.hpp"
+#include "CopyEngine.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Downsample a pair of rows into a row of half the width.
+     * @param upper First element of the upper source row.
+     * @param lower First element of the lower source row.
+     * @param target First element of the target row.
+     * @param columns Count of target pixels.
+     * @param channels Count of channels.
+     */
+    template <typename Element, typename Sum>
+    static void DownsampleRow(const Element* upper, const Element* lower, Element* target, int columns, int channels)
+    {
+        auto pixel_stride = 2 * channels;
+        for (int column = 0; column < columns; ++column)
+        {
+            for (int channel = 0; channel < channels; ++channel)
+            {
+                auto index = column * pixel_stride + channel;
+                auto sum = static_cast<Sum>(upper[index]) + static_cast<Sum>(upper[index + channels]) +
+                           static_cast<Sum>(lower[index]) + static_cast<Sum>(lower[index + channels]);
+                // Integer averages are rounded to the nearest value.
+                if constexpr (std::is_floating_point_v<Element>)
+                    target[column * channels + channel] = static_cast<Element>(sum * static_cast<Sum>(0.25));
+                else
+                    target[column * channels + channel] = static_cast<Element>((sum + 2) >> 2);
+            }
+        }
+    }
+
+    /// Downsample all rows of a picture, in parallel bands for big pictures.
+    template <typename Element, typename Sum>
+    static void DownsampleRows(const cv::Mat& source, cv::Mat& destination)
+    {
+        auto rows = static_cast<std::size_t>(destination.rows);
+        auto row_size = static_cast<std::size_t>(destination.cols) * destination.elemSize();
+        auto& engine = CopyEngine::GetDefault();
+        // Source bytes are 4 times the destination bytes, and they are all read in the pass.
+        bool parallel = row_size * rows * 5 >= engine.GetParallelThreshold();
+        auto band_rows = parallel ? std::max<std::size_t>(1, engine.GetBandSize() / std::max<std::size_t>(1, row_size))
+                                  : std::max<std::size_t>(1, rows);
+        engine.Run((rows + band_rows - 1) / band_rows, [&](std::size_t band){
+            auto end = std::min(rows, (band + 1) * band_rows);
+            for (auto row = band * band_rows; row < end; ++row)
+            {
+                DownsampleRow<Element, Sum>(
+                        reinterpret_cast<const Element*>(source.data + 2 * row * source.step[0]),
+                        reinterpret_cast<const Element*>(source.data + (2 * row + 1) * source.step[0]),
+                        reinterpret_cast<Element*>(destination.data + row * destination.step[0]),
+                        destination.cols, destination.channels());
+            }
+        });
+    }
+
+    /// Downsample a picture into a picture of half its width and height.
+    void PictureDownsampler::Downsample(const cv::Mat &source, cv::Mat &destination)
+    {
+        if (source.dims != 2 || destination.dims != 2 || source.type() != destination.type() ||
+            GetHalfSize(source.size()) != destination.size())
+            throw std::runtime_error("Failed to downsample picture: the destination is not half the source.");
+        if (destination.empty()) return;
+        switch (source.depth())
+        {
+            case CV_8U:
+                DownsampleRows<std::uint8_t, std::uint32_t>(source, destination);
+                break;
+            case CV_8S:
+                DownsampleRows<std::int8_t, std::int32_t>(source, destination);
+                break;
+            case CV_16U:
+                DownsampleRows<std::uint16_t, std::uint32_t>(source, destination);
+                break;
+            case CV_16S:
+                DownsampleRows<std::int16_t, std::int32_t>(source, destination);
+                break;
+            case CV_32S:
+                DownsampleRows<std::int32_t, std::int64_t>(source, destination);
+                break;
+            case CV_32F:
+                DownsampleRows<float, float>(source, destination);
+                break;
+            case CV_64F:
+                DownsampleRows<double, double>(source, destination);
+                break;
+            default:
+                throw std::runtime_error("Failed to downsample picture: the depth is not supported.");
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Picture downsampler producing the levels of a picture pyramid.
+     * @details
+     *  Every pixel of a level is the average of a 2 x 2 block of the previous level, and the last row or column
+     *  of an odd sized level is dropped, so the levels of a picture never take more than a third of its bytes.
+     *  Big pictures are downsampled in bands of rows by the default CopyEngine.
+     */
+    class PictureDownsampler
+    {
+    public:
+        /// Get the size of the level downsampled from a picture of the given size, which is empty if it is too small.
+        static cv::Size GetHalfSize(const cv::Size& size)
+        {
+            return {size.width / 2, size.height / 2};
+        }
+
+        /**
+         * @brief Downsample a picture into a picture of half its width and height, without reallocating it.
+         * @param source Picture of 2 dimensions.
+         * @param destination Picture of the size given by GetHalfSize() with the type of the source,
+         *                    such as a level mapped onto shared memory.
+         * @throws runtime_error If the pictures do not match, or the depth is not supported.
+         */
+        static void Downsample(const cv::Mat& source, cv::Mat& destination);
+    };
+}
\ No newline at end of file
@@ -1,19 +1,75 @@
 #include "PictureReader.hpp"
 #include "HeaderCoder.hpp"
+#include "Notifier.hpp"
+#include "PictureCopier.hpp"
+#include "PayloadCodec.hpp"
+
+#include <cstring>
+#include <thread>
 
 namespace Gaia::SharedPicture
 {
-    /// Open the shared memory block and construct a reader on it.
-    PictureReader::PictureReader(const std::string &shared_block_name)
+    /// Open the shared memory block, in read-write mode if permitted, otherwise in read-only mode.
+    void PictureReader::Open(const char* shared_block_name)
     {
+        // Holding a slot of a ring layout block requires writing its reader counter.
         try
+        {
+            if (Mapping.ReadOnly)
+                throw boost::interprocess::interprocess_exception("The block is mapped in read-only mode.");
+            MemoryObject = std::make_unique<boost::interprocess::shared_memory_object>(
+                    boost::interprocess::open_only, shared_block_name,
+                    boost::interprocess::read_write);
+            RegionObject = std::make_shared<boost::interprocess::mapped_region>(
+                    *MemoryObject,
+                    boost::interprocess::read_write);
+        }catch(boost::interprocess::interprocess_exception&)
         {
             MemoryObject = std::make_unique<boost::interprocess::shared_memory_object>(
-                    boost::interprocess::open_only, shared_block_name.c_str(),
+                    boost::interprocess::open_only, shared_block_name,
                     boost::interprocess::read_only);
-            RegionObject = std::make_unique<boost::interprocess::mapped_region>(
+            RegionObject = std::make_shared<boost::interprocess::mapped_region>(
                     *MemoryObject,
                     boost::interprocess::read_only);
+        }
+        BlockMapping::Prepare(GetMemoryPointer(), GetMemorySize(), Mapping, false);
+    }
+
+    /// Open the huge page file of the memory block, in read-write mode if permitted, otherwise in read-only mode.
+    void PictureReader::OpenFile(const char* path)
+    {
+        try
+        {
+            if (Mapping.ReadOnly)
+                throw boost::interprocess::interprocess_exception("The block is mapped in read-only mode.");
+            FileObject = std::make_unique<boost::interprocess::file_mapping>(path, boost::interprocess::read_write);
+            RegionObject = std::make_shared<boost::interprocess::mapped_region>(
+                    *FileObject,
+                    boost::interprocess::read_write);
+        }catch(boost::interprocess::interprocess_exception&)
+        {
+            FileObject = std::make_unique<boost::interprocess::file_mapping>(path, boost::interprocess::read_only);
+            RegionObject = std::make_shared<boost::interprocess::mapped_region>(
+                    *FileObject,
+                    boost::interprocess::read_only);
+        }
+        BlockMapping::Prepare(GetMemoryPointer(), GetMemorySize(), Mapping, false);
+    }
+
+    /// Open the shared memory block and construct a reader on it.
+    PictureReader::PictureReader(const std::string &shared_block_name, const MappingOptions& mapping):
+        Mapping(mapping)
+    {
+        try
+        {
+            if (Mapping.HugePageDirectory.empty())
+            {
+                BlockName = shared_block_name;
+                Open(shared_block_name.c_str());
+                FollowGeneration();
+            }
+            else
+                OpenFile(BlockMapping::GetHugePagePath(Mapping, shared_block_name).c_str());
         }catch(std::exception& error)
         {
             throw std::runtime_error(std::string("Failed to open shared picture:") + error.what());
@@ -21,56 +77,271 @@ namespace Gaia::SharedPicture
 
     }
 
+    /// Construct a reader on a memory block in a mapped region shared with other pictures.
+    PictureReader::PictureReader(std::shared_ptr<boost::interprocess::mapped_region> region, std::size_t offset,
+                                 std::size_t size):
+        RegionObject(std::move(region)), RegionOffset(offset), RegionSize(size)
+    {}
+
     /// Copy constructor.
-    PictureReader::PictureReader(const PictureReader &target)
+    PictureReader::PictureReader(const PictureReader &target):
+        Mapping(target.Mapping), BlockName(target.BlockName)
     {
         if (target.MemoryObject)
         {
-            MemoryObject = std::make_unique<boost::interprocess::shared_memory_object>(
-                    boost::interprocess::open_only, target.MemoryObject->get_name(),
-                    boost::interprocess::read_only);
-            RegionObject = std::make_unique<boost::interprocess::mapped_region>(
-                    *MemoryObject,
-                    boost::interprocess::read_only);
+            Open(target.MemoryObject->get_name());
+        }
+        else if (target.FileObject)
+        {
+            OpenFile(target.FileObject->get_name());
+        }
+        else
+        {
+            // Readers of an arena stream share the mapping of the arena.
+            RegionObject = target.RegionObject;
+            RegionOffset = target.RegionOffset;
+            RegionSize = target.RegionSize;
         }
     }
 
     /// Move constructor.
     PictureReader::PictureReader(PictureReader&& target) noexcept:
-        MemoryObject(std::move(target.MemoryObject)), RegionObject(std::move(target.RegionObject))
-    {}
+        MemoryObject(std::move(target.MemoryObject)), FileObject(std::move(target.FileObject)),
+        RegionObject(std::move(target.RegionObject)), RegionOffset(target.RegionOffset), RegionSize(target.RegionSize),
+        HeldLease(std::move(target.HeldLease)), LastSequence(target.LastSequence), Mapping(std::move(target.Mapping)),
+        BlockName(std::move(target.BlockName)), CursorIndex(target.CursorIndex), CursorToken(target.CursorToken),
+        Readiness(std::move(target.Readiness)), ReadinessIndex(target.ReadinessIndex)
+    {
+        target.CursorIndex = NoSlot;
+        target.ReadinessIndex = NoSlot;
+    }
+
+    /// Release the held slot, the registered reader cursor and the readiness subscription.
+    PictureReader::~PictureReader()
+    {
+        HeldLease.Release();
+        UnsubscribeReadiness();
+        // The cursor is only released if it has not been taken over by another reader.
+        if (CursorIndex != NoSlot && GetMemoryPointer())
+            BlockLayout::GetCursor(GetMemoryPointer(), CursorIndex)->Owner.compare_exchange_strong(CursorToken, 0);
+    }
+
+    /// Decode the header of a slot and construct a picture on its picture bytes.
+    cv::Mat PictureReader::GetSlotPicture(unsigned int slot)
+    {
+        auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), slot);
+        PictureHeader header;
+        if (!HeaderCoder::DecodeExtended(slot_header->Picture, header))
+        {
+            throw std::runtime_error("Failed to read picture, header information decoding failed.");
+        }
+        if (slot_header->Codec != PayloadCodecs::Raw)
+        {
+            throw std::runtime_error("Failed to read picture, the picture is encoded, "
+                                     "it can only be read by ReadCopy() or TryRead().");
+        }
+        std::size_t row_stride = slot_header->RowStride;
+        if (row_stride < HeaderCoder::GetRowSize(header))
+        {
+            throw std::runtime_error("Failed to read picture, row stride is lesser than the row size.");
+        }
+        // The row stride is read from shared memory, so the rows are bounded by division instead of a product.
+        if (row_stride != 0 && BlockLayout::GetSlotCapacity(BlockLayout::GetBlockHeader(GetMemoryPointer())) /
+            row_stride < HeaderCoder::GetRowCount(header))
+        {
+            throw std::runtime_error("Failed to read picture, "
+                                     "insufficient shared memory for picture bytes described in header.");
+        }
+        return HeaderCoder::GetPicture(header, BlockLayout::GetSlotPointer(GetMemoryPointer(), slot), row_stride);
+    }
+
+    /// Construct a picture on a downsampled level of the picture in a slot.
+    cv::Mat PictureReader::GetLevelPicture(unsigned int slot, unsigned int level)
+    {
+        if (level == 0) return GetSlotPicture(slot);
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), slot);
+        PictureHeader header;
+        if (!HeaderCoder::DecodeExtended(slot_header->Picture, header))
+        {
+            throw std::runtime_error("Failed to read picture, header information decoding failed.");
+        }
+        if (level > slot_header->LevelCount || level > MaxPyramidLevels)
+        {
+            throw std::runtime_error("Failed to read picture, the picture has no pyramid level " +
+                                     std::to_string(level) + ".");
+        }
+        const auto& geometry = slot_header->Levels[level - 1];
+        auto type = HeaderCoder::GetCVPixelType(header);
+        if (geometry.Offset + static_cast<std::size_t>(geometry.Rows) * geometry.Columns * CV_ELEM_SIZE(type) >
+            block->SlotSize - block->PayloadOffset)
+        {
+            throw std::runtime_error("Failed to read picture, "
+                                     "insufficient shared memory for the pyramid level described in header.");
+        }
+        return cv::Mat(static_cast<int>(geometry.Rows), static_cast<int>(geometry.Columns), type,
+                       BlockLayout::GetSlotPointer(GetMemoryPointer(), slot) + geometry.Offset);
+    }
+
+    /// Decode the picture in a slot into a caller owned picture.
+    void PictureReader::DecodeSlotPicture(unsigned int slot, cv::Mat &picture)
+    {
+        auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), slot);
+        PictureHeader header;
+        if (!HeaderCoder::DecodeExtended(slot_header->Picture, header))
+        {
+            throw std::runtime_error("Failed to read picture, header information decoding failed.");
+        }
+        if (slot_header->EncodedSize > BlockLayout::GetSlotCapacity(BlockLayout::GetBlockHeader(GetMemoryPointer())))
+        {
+            throw std::runtime_error("Failed to read picture, encoded size exceeds the slot.");
+        }
+        auto shape = HeaderCoder::GetShape(header);
+        picture.create(static_cast<int>(shape.size()), shape.data(), HeaderCoder::GetCVPixelType(header));
+        if (!PayloadCodec::Decode(BlockLayout::GetSlotPointer(GetMemoryPointer(), slot),
+                                  slot_header->EncodedSize, picture))
+        {
+            throw std::runtime_error("Failed to read picture, encoded picture bytes are broken.");
+        }
+    }
+
+    /// Move to the newest generation of the block if the mapped one has been resized by the writer.
+    bool PictureReader::FollowGeneration()
+    {
+        if (BlockName.empty() || !IsRing() ||
+            BlockLayout::GetBlockHeader(GetMemoryPointer())->NextGeneration.load(std::memory_order_acquire) == 0)
+            return false;
+        HeldLease.Release();
+        UnsubscribeReadiness();
+        // Retired blocks except the base one are removed, so the newest generation is looked up in the base block,
+        // and it is looked up again if the writer has resized the block once more meanwhile.
+        for (int attempt = 0; attempt < 8; ++attempt)
+        {
+            try
+            {
+                Open(BlockName.c_str());
+                if (!IsRing()) break;
+                auto generation = BlockLayout::GetBlockHeader(GetMemoryPointer())->NextGeneration.load();
+                if (generation == 0)
+                {
+                    SubscribeReadiness();
+                    return true;
+                }
+                Open(BlockLayout::GetGenerationName(BlockName, generation).c_str());
+                if (IsRing() && BlockLayout::GetBlockHeader(GetMemoryPointer())->NextGeneration.load() == 0)
+                {
+                    SubscribeReadiness();
+                    return true;
+                }
+            }catch(boost::interprocess::interprocess_exception&)
+            {}
+        }
+        throw std::runtime_error("Failed to read picture, failed to open the resized shared memory block.");
+    }
+
+    /// Hold the latest slot of a ring layout block without decoding its picture.
+    ReadLease PictureReader::HoldLatestSlot()
+    {
+        if (!IsRing())
+        {
+            throw std::runtime_error("Failed to lease picture, leases require the ring layout.");
+        }
+        FollowGeneration();
+        if (RegionObject->get_mode() != boost::interprocess::read_write)
+        {
+            throw std::runtime_error("Failed to lease picture, ring layout block is opened in read-only mode.");
+        }
+        if (IsQueue())
+        {
+            throw std::runtime_error("Failed to lease picture, slots can not be held in the queue mode.");
+        }
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        // Hold the latest slot, then check whether it is still the latest one,
+        // for the writer may have started to overwrite it before it is held.
+        auto slot = block->LatestSlot.load();
+        while (slot != NoSlot)
+        {
+            auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), slot);
+            slot_header->Readers.fetch_add(1);
+            auto latest_slot = block->LatestSlot.load();
+            if (latest_slot == slot) break;
+            slot_header->Readers.fetch_sub(1);
+            slot = latest_slot;
+        }
+        if (slot == NoSlot) return ReadLease();
+
+        auto lease = AdoptSlot(BlockLayout::GetSlotHeader(GetMemoryPointer(), slot), slot);
+        lease.Mapping = RegionObject;
+        LastSequence = lease.Sequence;
+        RecordRead(slot);
+        return lease;
+    }
+
+    /// Take over a slot whose reader counter has been increased by this reader.
+    ReadLease PictureReader::AdoptSlot(SlotHeader *slot_header, unsigned int slot)
+    {
+        ReadLease lease(&slot_header->Readers, slot, slot_header->Sequence.load() / 2);
+        lease.Metadata = &slot_header->Metadata;
+        return lease;
+    }
+
+    /// Hold the newest picture of a ring layout block.
+    ReadLease PictureReader::Lease()
+    {
+        auto lease = HoldLatestSlot();
+        if (lease)
+        {
+            lease.Picture = GetSlotPicture(lease.Slot);
+            lease.Header = HeaderCoder::GetHeader(lease.Picture);
+        }
+        return lease;
+    }
+
+    /// Hold the newest picture of a ring layout block without decoding encoded pictures.
+    ReadLease PictureReader::LeaseEncoded()
+    {
+        auto lease = HoldLatestSlot();
+        if (!lease) return lease;
+        auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), lease.Slot);
+        if (!HeaderCoder::DecodeExtended(slot_header->Picture, lease.Header))
+        {
+            throw std::runtime_error("Failed to lease picture, header information decoding failed.");
+        }
+        if (slot_header->Codec == PayloadCodecs::Raw)
+        {
+            lease.Picture = GetSlotPicture(lease.Slot);
+            return lease;
+        }
+        if (slot_header->EncodedSize > BlockLayout::GetSlotCapacity(BlockLayout::GetBlockHeader(GetMemoryPointer())))
+        {
+            throw std::runtime_error("Failed to lease picture, encoded size is bigger than the slot.");
+        }
+        lease.Codec = slot_header->Codec;
+        lease.Payload = BlockLayout::GetSlotPointer(GetMemoryPointer(), lease.Slot);
+        lease.PayloadSize = slot_header->EncodedSize;
+        return lease;
+    }
 
     /// Read a picture from the shared memory.
     cv::Mat PictureReader::Read()
     {
-        if (RegionObject && RegionObject->get_address())
+        if (GetMemoryPointer())
         {
+            if (IsRing())
+            {
+                HeldLease.Release();
+                HeldLease = Lease();
+                return HeldLease.GetPicture();
+            }
             PictureHeader header;
-            if (HeaderCoder::Decode(static_cast<unsigned char *>(RegionObject->get_address()), header))
+            if (HeaderCoder::Decode(GetMemoryPointer(), header))
             {
-                int byte_scale_factor = 1;
-                switch (header.PixelBits)
-                {
-                    case PictureHeader::PixelBitSizes::Bits8:
-                        byte_scale_factor = 1;
-                        break;
-                    case PictureHeader::PixelBitSizes::Bits16:
-                        byte_scale_factor = 2;
-                        break;
-                    case PictureHeader::PixelBitSizes::Bits32:
-                        byte_scale_factor = 4;
-                        break;
-                    case PictureHeader::PixelBitSizes::Bits64:
-                        byte_scale_factor = 8;
-                        break;
-                }
-                if (RegionObject->get_size() < header.Width * header.Height * header.Channels * byte_scale_factor)
+                if (GetMemorySize() - 10 < HeaderCoder::GetPictureSize(header))
                 {
                     throw std::runtime_error("Failed to read picture, "
                                              "insufficient shared memory for picture bytes described in header.");
                 }
-                return cv::Mat(cv::Size(header.Width, header.Height), HeaderCoder::GetCVPixelType(header),
-                               GetPointer());
+                return HeaderCoder::GetPicture(header, GetPointer());
             }
             else
             {
@@ -82,4 +353,531 @@ namespace Gaia::SharedPicture
             throw std::runtime_error("Failed to read picture, memory block is not opened.");
         }
     }
+
+    /// Read a downsampled level of the newest picture without copying it.
+    cv::Mat PictureReader::Read(unsigned int level)
+    {
+        if (level == 0) return Read();
+        HeldLease.Release();
+        auto lease = HoldLatestSlot();
+        if (lease) lease.Picture = GetLevelPicture(lease.Slot, level);
+        HeldLease = std::move(lease);
+        return HeldLease.GetPicture();
+    }
+
+    /// Read the newest picture with its metadata.
+    cv::Mat PictureReader::Read(FrameMetadata &metadata)
+    {
+        auto picture = Read();
+        metadata = HeldLease ? *HeldLease.GetMetadata() : FrameMetadata();
+        return picture;
+    }
+
+    /// Allocate a continuous picture with the same shape and type as the source, and copy the source into it.
+    static void CopyPicture(const cv::Mat& source, cv::Mat& destination)
+    {
+        destination.create(source.dims, source.size.p, source.type());
+        PictureCopier::Copy(source, destination);
+    }
+
+    /// Read a copy of the newest picture owned by the caller.
+    void PictureReader::ReadCopy(cv::Mat &picture)
+    {
+        if (IsRing())
+        {
+            // Without the permission to hold a slot, the copy is made under the sequence lock instead.
+            if (RegionObject->get_mode() != boost::interprocess::read_write || IsQueue())
+            {
+                std::uint64_t sequence;
+                if (TryRead(0, picture, sequence)) LastSequence = sequence;
+                else picture.release();
+                return;
+            }
+            auto lease = HoldLatestSlot();
+            if (!lease)
+            {
+                picture.release();
+                return;
+            }
+            if (BlockLayout::GetSlotHeader(GetMemoryPointer(), lease.GetSlot())->Codec != PayloadCodecs::Raw)
+                DecodeSlotPicture(lease.GetSlot(), picture);
+            else
+                CopyPicture(GetSlotPicture(lease.GetSlot()), picture);
+            return;
+        }
+        CopyPicture(Read(), picture);
+    }
+
+    /// Read a copy of the newest picture.
+    cv::Mat PictureReader::ReadCopy()
+    {
+        cv::Mat picture;
+        ReadCopy(picture);
+        return picture;
+    }
+
+    /// Read the newest picture converted into the given format.
+    void PictureReader::ReadConverted(cv::Mat &picture, const ConversionFormat &format)
+    {
+        if (IsRing())
+        {
+            if (RegionObject->get_mode() != boost::interprocess::read_write || IsQueue())
+            {
+                std::uint64_t sequence;
+                if (CopyLatestSlot(0, picture, sequence, &format)) LastSequence = sequence;
+                else picture.release();
+                return;
+            }
+            auto lease = HoldLatestSlot();
+            if (!lease)
+            {
+                picture.release();
+                return;
+            }
+            if (BlockLayout::GetSlotHeader(GetMemoryPointer(), lease.GetSlot())->Codec != PayloadCodecs::Raw)
+            {
+                cv::Mat decoded;
+                DecodeSlotPicture(lease.GetSlot(), decoded);
+                PictureConverter::Convert(decoded, picture, format);
+            }
+            else
+                PictureConverter::Convert(GetSlotPicture(lease.GetSlot()), picture, format);
+            return;
+        }
+        PictureConverter::Convert(Read(), picture, format);
+    }
+
+    /// Read a batch of pictures written by PictureWriter::Write(const std::vector<cv::Mat>&).
+    std::vector<cv::Mat> PictureReader::ReadBatch()
+    {
+        auto picture = Read();
+        std::vector<cv::Mat> batch;
+        if (picture.empty()) return batch;
+        if (picture.dims < 3)
+        {
+            throw std::runtime_error("Failed to read batch, the picture has only 2 dimensions.");
+        }
+        // Every element of the outermost dimension is a picture of the batch.
+        std::vector<int> shape(picture.size.p + 1, picture.size.p + picture.dims);
+        for (int index = 0; index < picture.size[0]; ++index)
+        {
+            batch.emplace_back(static_cast<int>(shape.size()), shape.data(), picture.type(),
+                               picture.data + index * picture.step[0], &picture.step[1]);
+        }
+        return batch;
+    }
+
+    /// Copy the newest picture out if it is newer than the given sequence number.
+    bool PictureReader::TryRead(std::uint64_t last_sequence, cv::Mat &picture, std::uint64_t &sequence,
+                                FrameMetadata* metadata)
+    {
+        return CopyLatestSlot(last_sequence, picture, sequence, nullptr, metadata);
+    }
+
+    /// Copy the newest picture out under the sequence lock if it is newer than the given sequence number.
+    bool PictureReader::CopyLatestSlot(std::uint64_t last_sequence, cv::Mat &picture, std::uint64_t &sequence,
+                                       const ConversionFormat* format, FrameMetadata* metadata)
+    {
+        if (!IsRing())
+        {
+            throw std::runtime_error("Failed to read picture, sequence numbers require the ring layout.");
+        }
+        FollowGeneration();
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        if (block->Sequence.load(std::memory_order_acquire) <= last_sequence) return false;
+
+        while (true)
+        {
+            auto slot = block->LatestSlot.load();
+            // A resized block continues the sequence numbers before its first slot is published.
+            if (slot == NoSlot) return false;
+            auto begin_sequence = BlockLayout::GetSlotHeader(GetMemoryPointer(), slot)->Sequence.load(
+                    std::memory_order_acquire);
+            // The slot may have stopped being the latest one since it is loaded: it may then be held for writing,
+            // or hold an older picture, and only a newer picture under a stable sequence lock is taken.
+            if (begin_sequence % 2 != 0 || begin_sequence == 0 || begin_sequence / 2 <= last_sequence)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            if (!CopyLockedSlot(slot, begin_sequence, picture, format, metadata))
+            {
+                if (RegionObject->get_mode() == boost::interprocess::read_write)
+                    block->Statistics.TornReads.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (block->LatestSlot.load() != slot) continue;
+            sequence = begin_sequence / 2;
+            RecordRead(slot);
+            return true;
+        }
+    }
+
+    /// Copy or decode the picture in a slot, under its sequence lock.
+    bool PictureReader::CopyLockedSlot(unsigned int slot, std::uint64_t sequence_lock, cv::Mat &picture,
+                                       const ConversionFormat* format, FrameMetadata* metadata)
+    {
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), slot);
+        // The header is decoded from a copy, for it may be changed by the writer at any time.
+        unsigned char encoded_header[sizeof(SlotHeader::Picture)];
+        std::memcpy(encoded_header, slot_header->Picture, sizeof(encoded_header));
+        PictureHeader header;
+        std::size_t row_stride = slot_header->RowStride;
+        auto codec = slot_header->Codec;
+        std::size_t encoded_size = slot_header->EncodedSize;
+        bool valid = HeaderCoder::DecodeExtended(encoded_header, header) &&
+                     row_stride >= HeaderCoder::GetRowSize(header) &&
+                     (row_stride == 0 ||
+                      HeaderCoder::GetRowCount(header) <= BlockLayout::GetSlotCapacity(block) / row_stride) &&
+                     encoded_size <= BlockLayout::GetSlotCapacity(block);
+        try
+        {
+            if (valid && codec == PayloadCodecs::Raw)
+            {
+                auto source = HeaderCoder::GetPicture(
+                        header, BlockLayout::GetSlotPointer(GetMemoryPointer(), slot), row_stride);
+                if (format) PictureConverter::Convert(source, picture, *format);
+                else CopyPicture(source, picture);
+            }
+            else if (valid)
+            {
+                // Encoded pictures are decoded before they are converted.
+                cv::Mat decoded;
+                auto& target = format ? decoded : picture;
+                auto shape = HeaderCoder::GetShape(header);
+                target.create(static_cast<int>(shape.size()), shape.data(), HeaderCoder::GetCVPixelType(header));
+                valid = PayloadCodec::Decode(BlockLayout::GetSlotPointer(GetMemoryPointer(), slot),
+                                             encoded_size, target);
+                if (valid && format) PictureConverter::Convert(decoded, picture, *format);
+            }
+        }catch(std::runtime_error&)
+        {
+            // A header torn by the writer may describe a picture which can not be converted.
+            if (slot_header->Sequence.load() != sequence_lock) return false;
+            throw;
+        }
+        if (metadata) std::memcpy(static_cast<void*>(metadata), &slot_header->Metadata, sizeof(FrameMetadata));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot_header->Sequence.load(std::memory_order_relaxed) != sequence_lock) return false;
+        if (!valid)
+        {
+            throw std::runtime_error("Failed to read picture, header information decoding failed.");
+        }
+        return true;
+    }
+
+    /// Copy the newest picture out if it is newer than the last picture read by this reader.
+    bool PictureReader::ReadIfNewer(cv::Mat &picture)
+    {
+        std::uint64_t sequence;
+        if (!TryRead(LastSequence, picture, sequence)) return false;
+        LastSequence = sequence;
+        return true;
+    }
+
+    /// Wait until a picture newer than the last read one is published, then read it.
+    cv::Mat PictureReader::WaitNext(std::chrono::microseconds timeout)
+    {
+        if (!IsRing())
+        {
+            throw std::runtime_error("Failed to wait for picture, notifications require the ring layout.");
+        }
+        if (RegionObject->get_mode() != boost::interprocess::read_write)
+        {
+            throw std::runtime_error("Failed to wait for picture, ring layout block is opened in read-only mode.");
+        }
+        FollowGeneration();
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        // Register as a waiter before checking the sequence, so the writer will not miss this reader.
+        block->Waiters.fetch_add(1);
+        bool published = false;
+        while (true)
+        {
+            auto notification = block->Notification.load();
+            if (block->NextGeneration.load() != 0 && !BlockName.empty())
+            {
+                // The writer has resized the block, leave the retired block before it is unmapped.
+                block->Waiters.fetch_sub(1);
+                FollowGeneration();
+                block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+                block->Waiters.fetch_add(1);
+                continue;
+            }
+            if (block->Sequence.load() > LastSequence)
+            {
+                published = true;
+                break;
+            }
+            auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+                    deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0 || !Notifier::Wait(block->Notification, notification, remaining))
+                break;
+        }
+        block->Waiters.fetch_sub(1);
+        if (!published) return cv::Mat();
+        return Read();
+    }
+
+    /// Register a reader cursor of a block in the queue mode.
+    ReaderCursor* PictureReader::RegisterCursor()
+    {
+        if (!IsQueue())
+        {
+            throw std::runtime_error("Failed to dequeue picture, the block is not in the queue mode.");
+        }
+        if (CursorIndex != NoSlot)
+        {
+            auto* cursor = BlockLayout::GetCursor(GetMemoryPointer(), CursorIndex);
+            if (cursor->Owner.load(std::memory_order_acquire) == CursorToken) return cursor;
+            // This reader has not dequeued for so long that its cursor has been taken over.
+            CursorIndex = NoSlot;
+        }
+        if (RegionObject->get_mode() != boost::interprocess::read_write)
+        {
+            throw std::runtime_error("Failed to dequeue picture, queue mode block is opened in read-only mode.");
+        }
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        if (CursorToken == 0) CursorToken = BlockLayout::MakeOwnerToken();
+        for (unsigned int index = 0; index < block->QueueReaders; ++index)
+        {
+            auto* cursor = BlockLayout::GetCursor(GetMemoryPointer(), index);
+            auto owner = cursor->Owner.load(std::memory_order_acquire);
+            auto heartbeat = cursor->Heartbeat.load(std::memory_order_relaxed);
+            auto now = BlockLayout::GetTimeStamp();
+            // Cursors of crashed readers are never released, so they are taken over once their heartbeats stop.
+            if (owner != 0 && now - heartbeat <= CursorTimeout) continue;
+            // Refreshing the heartbeat first lets only one of the readers racing for a stale cursor take it.
+            if (!cursor->Heartbeat.compare_exchange_strong(heartbeat, now) ||
+                !cursor->Owner.compare_exchange_strong(owner, CursorToken)) continue;
+            cursor->Dropped.store(0, std::memory_order_relaxed);
+            cursor->Position.store(block->Sequence.load(std::memory_order_acquire) + 1, std::memory_order_relaxed);
+            CursorIndex = index;
+            return cursor;
+        }
+        throw std::runtime_error("Failed to dequeue picture, all reader cursors are registered.");
+    }
+
+    /// Consume the next picture of a block in the queue mode.
+    bool PictureReader::Dequeue(cv::Mat &picture, std::uint64_t &dropped, std::chrono::microseconds timeout,
+                                FrameMetadata* metadata)
+    {
+        auto* cursor = RegisterCursor();
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        auto position = cursor->Position.load(std::memory_order_relaxed);
+        cursor->Heartbeat.store(BlockLayout::GetTimeStamp(), std::memory_order_relaxed);
+        dropped = 0;
+
+        if (block->Sequence.load(std::memory_order_acquire) < position && timeout.count() > 0)
+        {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            // Register as a waiter before checking the sequence, so the writer will not miss this reader.
+            block->Waiters.fetch_add(1);
+            while (true)
+            {
+                auto notification = block->Notification.load();
+                if (block->Sequence.load() >= position) break;
+                auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+                        deadline - std::chrono::steady_clock::now());
+                if (remaining.count() <= 0) break;
+                // Long waits are sliced, so the heartbeat of the cursor never gets older than the cursor timeout.
+                auto slice = std::min(remaining, std::chrono::microseconds(CursorTimeout / 4000));
+                if (!Notifier::Wait(block->Notification, notification, slice) && slice == remaining) break;
+                cursor->Heartbeat.store(BlockLayout::GetTimeStamp(), std::memory_order_relaxed);
+            }
+            block->Waiters.fetch_sub(1);
+        }
+
+        bool consumed = false;
+        while (!consumed)
+        {
+            auto latest = block->Sequence.load(std::memory_order_acquire);
+            if (latest < position) break;
+            // Pictures older than the slot count have been overwritten, the lapped reader skips them.
+            auto oldest = latest >= block->SlotCount ? latest - block->SlotCount + 1 : 1;
+            if (position < oldest)
+            {
+                dropped += oldest - position;
+                position = oldest;
+            }
+            auto slot = static_cast<unsigned int>(position % block->SlotCount);
+            auto sequence_lock = BlockLayout::GetSlotHeader(GetMemoryPointer(), slot)->Sequence.load(
+                    std::memory_order_acquire);
+            // Any other lock value means the slot is being overwritten or has been overwritten with a newer picture.
+            consumed = sequence_lock == position * 2 && CopyLockedSlot(slot, sequence_lock, picture, nullptr, metadata);
+            if (consumed)
+            {
+                LastSequence = position;
+                RecordRead(slot);
+            }
+            else ++dropped;
+            ++position;
+        }
+
+        // A cursor taken over meanwhile belongs to another reader now, which has reset its position.
+        if (cursor->Owner.load(std::memory_order_acquire) == CursorToken)
+        {
+            cursor->Position.store(position, std::memory_order_relaxed);
+            if (dropped != 0) cursor->Dropped.fetch_add(dropped, std::memory_order_relaxed);
+        }
+        if (dropped != 0) block->Statistics.DroppedPictures.fetch_add(dropped, std::memory_order_relaxed);
+        return consumed;
+    }
+
+    /// Consume up to the given count of pictures already published.
+    std::size_t PictureReader::DequeueBatch(std::vector<cv::Mat> &pictures, std::size_t max_count,
+                                            std::uint64_t &dropped)
+    {
+        pictures.resize(max_count);
+        dropped = 0;
+        std::size_t count = 0;
+        std::uint64_t skipped;
+        while (count < max_count)
+        {
+            bool consumed = Dequeue(pictures[count], skipped);
+            dropped += skipped;
+            if (!consumed) break;
+            ++count;
+        }
+        pictures.resize(count);
+        return count;
+    }
+
+    /// Subscribe the readiness channel to the mapped block, if it is created.
+    void PictureReader::SubscribeReadiness()
+    {
+        if (!Readiness || RegionObject->get_mode() != boost::interprocess::read_write) return;
+        ReadinessIndex = Readiness->Subscribe(BlockLayout::GetBlockHeader(GetMemoryPointer()));
+        if (ReadinessIndex == NoSlot)
+        {
+            throw std::runtime_error("Failed to subscribe readiness channel, all subscription entries are taken.");
+        }
+    }
+
+    /// Cancel the subscription of the readiness channel to the mapped block.
+    void PictureReader::UnsubscribeReadiness()
+    {
+        if (ReadinessIndex == NoSlot || !GetMemoryPointer()) return;
+        Readiness->Unsubscribe(BlockLayout::GetBlockHeader(GetMemoryPointer()), ReadinessIndex);
+        ReadinessIndex = NoSlot;
+    }
+
+    /// Get a descriptor which becomes readable when pictures are published.
+    int PictureReader::GetReadinessDescriptor()
+    {
+        if (!IsRing())
+        {
+            throw std::runtime_error("Failed to get readiness descriptor, notifications require the ring layout.");
+        }
+        if (RegionObject->get_mode() != boost::interprocess::read_write)
+        {
+            throw std::runtime_error("Failed to get readiness descriptor, "
+                                     "ring layout block is opened in read-only mode.");
+        }
+        FollowGeneration();
+        if (!Readiness)
+        {
+            Readiness = std::make_unique<ReadinessChannel>();
+            SubscribeReadiness();
+        }
+        return Readiness->GetDescriptor();
+    }
+
+    /// Discard the pending notifications of the readiness descriptor.
+    void PictureReader::ClearReadiness()
+    {
+        if (Readiness) Readiness->Drain();
+    }
+
+    /// Record a picture read from the given slot into the statistics of the block.
+    void PictureReader::RecordRead(unsigned int slot)
+    {
+        // Readers mapping the block in read-only mode, such as monitors, are not counted.
+        if (RegionObject->get_mode() != boost::interprocess::read_write) return;
+        auto& statistics = BlockLayout::GetBlockHeader(GetMemoryPointer())->Statistics;
+        statistics.ReadPictures.fetch_add(1, std::memory_order_relaxed);
+        auto publish_time = BlockLayout::GetSlotHeader(GetMemoryPointer(), slot)->Metadata.PublishTime;
+        auto now = BlockLayout::GetTimeStamp();
+        if (publish_time != 0 && now >= publish_time) BlockStatistics::Record(statistics.ReadLag, now - publish_time);
+    }
+
+    /// Get the statistics of a ring layout block.
+    const BlockStatistics* PictureReader::GetStatistics() const
+    {
+        if (!GetMemoryPointer() || !IsRing()) return nullptr;
+        return &BlockLayout::GetBlockHeader(GetMemoryPointer())->Statistics;
+    }
+
+    /// Get the count of pictures dropped by this reader in the queue mode since its cursor is registered.
+    std::uint64_t PictureReader::GetDroppedCount() const
+    {
+        if (CursorIndex == NoSlot || !GetMemoryPointer()) return 0;
+        return BlockLayout::GetCursor(GetMemoryPointer(), CursorIndex)->Dropped.load(std::memory_order_relaxed);
+    }
+
+    /// Get the tiles of the last read picture which have changed since the given picture.
+    bool PictureReader::GetChangedTiles(std::uint64_t since_sequence, std::vector<cv::Rect> &tiles)
+    {
+        if (!IsRing())
+        {
+            throw std::runtime_error("Failed to get changed tiles, tiles require the ring layout.");
+        }
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        if (block->TileSize == 0)
+        {
+            throw std::runtime_error("Failed to get changed tiles, the block has no tiles.");
+        }
+        tiles.clear();
+        if (since_sequence >= LastSequence) return true;
+        if (since_sequence == 0) return false;
+
+        std::uint64_t dirty_tiles[MaxDirtyTiles / 64] {};
+        std::uint32_t columns = 0, rows = 0;
+        PictureHeader header;
+        // Walk back from the last read picture, every picture must still be in a slot.
+        for (auto sequence = LastSequence; sequence > since_sequence; --sequence)
+        {
+            bool found = false;
+            for (unsigned int slot = 0; slot < block->SlotCount && !found; ++slot)
+            {
+                auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), slot);
+                if (slot_header->Sequence.load(std::memory_order_acquire) != sequence * 2) continue;
+                std::uint64_t slot_tiles[MaxDirtyTiles / 64];
+                std::memcpy(slot_tiles, slot_header->DirtyTiles, sizeof(slot_tiles));
+                std::uint32_t slot_columns = slot_header->TileColumns, slot_rows = slot_header->TileRows;
+                std::uint64_t base = slot_header->TileBase;
+                unsigned char encoded_header[sizeof(SlotHeader::Picture)];
+                std::memcpy(encoded_header, slot_header->Picture, sizeof(encoded_header));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot_header->Sequence.load(std::memory_order_relaxed) != sequence * 2) break;
+                if (slot_columns == 0 || base + 1 != sequence ||
+                    static_cast<std::size_t>(slot_columns) * slot_rows > MaxDirtyTiles) return false;
+                if (sequence == LastSequence)
+                {
+                    if (!HeaderCoder::DecodeExtended(encoded_header, header)) return false;
+                    columns = slot_columns;
+                    rows = slot_rows;
+                }
+                else if (slot_columns != columns || slot_rows != rows) return false;
+                for (std::size_t word = 0; word < (columns * rows + 63) / 64; ++word)
+                {
+                    dirty_tiles[word] |= slot_tiles[word];
+                }
+                found = true;
+            }
+            if (!found) return false;
+        }
+
+        auto tile_size = static_cast<int>(block->TileSize);
+        auto width = static_cast<int>(header.Width), height = static_cast<int>(header.Height);
+        for (std::uint32_t index = 0; index < columns * rows; ++index)
+        {
+            if ((dirty_tiles[index / 64] & (std::uint64_t(1) << (index % 64))) == 0) continue;
+            auto x = static_cast<int>(index % columns) * tile_size;
+            auto y = static_cast<int>(index / columns) * tile_size;
+            tiles.emplace_back(x, y, std::min(tile_size, width - x), std::min(tile_size, height - y));
+        }
+        return true;
+    }
 }
\ No newline at end of file
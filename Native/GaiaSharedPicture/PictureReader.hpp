@@ -2,64 +2,371 @@
 
 #include <string>
 #include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/file_mapping.hpp>
 #include <boost/interprocess/mapped_region.hpp>
 #include <memory>
+#include <chrono>
+#include <vector>
 #include <opencv2/opencv.hpp>
 
+#include "BlockLayout.hpp"
+#include "BlockMapping.hpp"
+#include "PictureConverter.hpp"
+#include "ReadinessChannel.hpp"
+#include "ReadLease.hpp"
+
 namespace Gaia::SharedPicture
 {
     /**
      * @brief Picture reader provides function to read a picture from a shared memory block.
+     * @details
+     *  For a ring layout block, the slot of the last read picture is held by this reader
+     *  until the next read or the destruction of this reader, so the writer will not overwrite it.
      */
     class PictureReader
     {
     protected:
         /// Shared memory management object.
         std::unique_ptr<boost::interprocess::shared_memory_object> MemoryObject;
+        /// Huge page file management object, used instead of the shared memory object on hugetlbfs.
+        std::unique_ptr<boost::interprocess::file_mapping> FileObject;
         /// Shared memory accessor object.
-        std::unique_ptr<boost::interprocess::mapped_region> RegionObject;
+        std::shared_ptr<boost::interprocess::mapped_region> RegionObject;
+        /// Offset of the memory block of this reader in the mapped region.
+        std::size_t RegionOffset {0};
+        /// Bytes of the memory block of this reader, 0 means the rest of the mapped region.
+        std::size_t RegionSize {0};
+        /// Lease of the ring layout slot held for the last read picture.
+        ReadLease HeldLease;
+        /// Sequence number of the last picture read by this reader.
+        std::uint64_t LastSequence {0};
+        /// Mapping options of the memory block.
+        MappingOptions Mapping;
+        /// Base name of the shared memory block, empty for blocks which can not be resized.
+        std::string BlockName;
+        /// Index of the reader cursor registered by this reader in the queue mode.
+        unsigned int CursorIndex {NoSlot};
+        /// Owner token written into the registered reader cursor.
+        std::uint64_t CursorToken {0};
+        /// Readiness channel of this reader, created by GetReadinessDescriptor().
+        std::unique_ptr<ReadinessChannel> Readiness;
+        /// Index of the subscription entry of the readiness channel in the mapped block.
+        unsigned int ReadinessIndex {NoSlot};
+
+        /// Open the shared memory block, in read-write mode if permitted, otherwise in read-only mode.
+        void Open(const char* shared_block_name);
+        /// Open the huge page file of the memory block, in read-write mode if permitted, otherwise in read-only mode.
+        void OpenFile(const char* path);
+        /// Decode the header of a slot and construct a picture on its picture bytes, which must be raw.
+        cv::Mat GetSlotPicture(unsigned int slot);
+        /// Construct a picture on a downsampled level of the picture in a slot, level 0 is the picture itself.
+        cv::Mat GetLevelPicture(unsigned int slot, unsigned int level);
+        /// Decode the encoded picture in a slot into a caller owned picture.
+        void DecodeSlotPicture(unsigned int slot, cv::Mat& picture);
+        /// Hold the latest slot of a ring layout block without constructing its picture.
+        ReadLease HoldLatestSlot();
+        /// Take over a slot whose reader counter has been increased by this reader, without constructing its picture.
+        static ReadLease AdoptSlot(SlotHeader* slot_header, unsigned int slot);
+        /**
+         * @brief Copy or decode the picture in a slot, under its sequence lock.
+         * @param slot Index of the slot.
+         * @param sequence_lock Value of the sequence lock of the slot loaded before copying, must be even.
+         * @param picture Caller owned picture to copy or decode into.
+         * @param format Target format to convert the picture into, or null to copy it as it is.
+         * @param metadata Metadata to copy the metadata of the picture into, or null to skip it.
+         * @retval true The copy is consistent, the sequence lock is not changed while copying.
+         * @retval false The writer has changed the slot while copying, the picture content is undefined.
+         * @throws runtime_error If the header information in the slot is broken.
+         */
+        bool CopyLockedSlot(unsigned int slot, std::uint64_t sequence_lock, cv::Mat& picture,
+                            const ConversionFormat* format = nullptr, FrameMetadata* metadata = nullptr);
+        /// Copy the newest picture out under the sequence lock if it is newer than the given one, see TryRead().
+        bool CopyLatestSlot(std::uint64_t last_sequence, cv::Mat& picture, std::uint64_t& sequence,
+                            const ConversionFormat* format, FrameMetadata* metadata = nullptr);
+        /**
+         * @brief Register a reader cursor of a block in the queue mode, starting from the next published picture.
+         * @details
+         *  Cursors whose owners have not refreshed their heartbeats for CursorTimeout are taken over;
+         *  if the cursor of this reader has been taken over, a new one is registered.
+         * @throws runtime_error If the block is opened in read-only mode, or all cursors are registered.
+         */
+        ReaderCursor* RegisterCursor();
+        /**
+         * @brief Subscribe the readiness channel to the mapped block, if it is created.
+         * @throws runtime_error If all subscription entries of the block are taken.
+         */
+        void SubscribeReadiness();
+        /// Cancel the subscription of the readiness channel to the mapped block.
+        void UnsubscribeReadiness();
+        /// Record a picture read from the given slot into the statistics of the block, if it is mapped writable.
+        void RecordRead(unsigned int slot);
+        /**
+         * @brief Move to the newest generation of the block if the mapped one has been resized by the writer.
+         * @retval true The reader has moved to a new block, the held slot is released.
+         * @retval false The mapped block is still in use, which costs only an atomic load to check.
+         */
+        bool FollowGeneration();
+
+        friend class SharedPictureArena;
+
+        /**
+         * @brief Construct a reader on a memory block in a mapped region shared with other pictures.
+         * @param region Mapped region holding the memory block.
+         * @param offset Offset of the memory block in the region.
+         * @param size Bytes of the memory block.
+         */
+        PictureReader(std::shared_ptr<boost::interprocess::mapped_region> region, std::size_t offset,
+                      std::size_t size);
 
     public:
         /**
          * @brief Open the shared memory block and construct a reader on it.
          * @param shared_block_name Name of the shared memory block.
+         * @param mapping Mapping options matching the ones of the writer,
+         *                the huge page directory must be the same, NUMA binding is left to the writer.
          */
-        explicit PictureReader(const std::string& shared_block_name);
+        explicit PictureReader(const std::string& shared_block_name, const MappingOptions& mapping = MappingOptions());
 
         /// Move constructor.
         PictureReader(PictureReader&& target) noexcept;
         /// Copy constructor.
         PictureReader(const PictureReader& target);
 
+        /// Release the held slot and the registered reader cursor.
+        virtual ~PictureReader();
+
+        /// Check whether the shared memory block is in the ring layout or not.
+        [[nodiscard]] inline bool IsRing() const
+        {
+            if (auto* address = GetMemoryPointer())
+                return BlockLayout::IsRing(address, GetMemorySize());
+            return false;
+        }
+
         /// Get the address of the picture buffer memory, which header is not included.
         [[nodiscard]] inline unsigned char* GetPointer() const
         {
-            if (RegionObject && RegionObject->get_address())
-                return static_cast<unsigned char*>(RegionObject->get_address()) + 10;
+            if (auto* address = GetMemoryPointer())
+            {
+                if (!IsRing()) return address + 10;
+                if (HeldLease) return BlockLayout::GetSlotPointer(address, HeldLease.GetSlot());
+            }
             return nullptr;
         }
 
+        /// Get the sequence number of the newest published picture, 0 if nothing is published or not in ring layout.
+        [[nodiscard]] inline std::uint64_t GetSequence() const
+        {
+            if (!IsRing()) return 0;
+            return BlockLayout::GetBlockHeader(GetMemoryPointer())->Sequence.load(std::memory_order_acquire);
+        }
+
+        /// Check whether the shared memory block is in the queue mode or not.
+        [[nodiscard]] inline bool IsQueue() const
+        {
+            return IsRing() && BlockLayout::GetBlockHeader(GetMemoryPointer())->QueueReaders != 0;
+        }
+
+        /// Get the sequence number of the last picture read by this reader.
+        [[nodiscard]] inline std::uint64_t GetLastSequence() const noexcept
+        {
+            return LastSequence;
+        }
+
         /// Get the address of the shared memory.
-        [[nodiscard]] inline unsigned char* GetMemoryPointer()
+        [[nodiscard]] inline unsigned char* GetMemoryPointer() const
         {
             if (RegionObject && RegionObject->get_address())
-                return static_cast<unsigned char*>(RegionObject->get_address());
+                return static_cast<unsigned char*>(RegionObject->get_address()) + RegionOffset;
             return nullptr;
         }
 
         /// Get the size of the shared memory.
-        [[nodiscard]] inline std::size_t GetMemorySize()
+        [[nodiscard]] inline std::size_t GetMemorySize() const
         {
-            if (RegionObject) return RegionObject->get_size();
-            return 0;
+            if (!RegionObject) return 0;
+            return RegionSize != 0 ? RegionSize : RegionObject->get_size() - RegionOffset;
         }
 
         /**
          * @brief Read a picture from the connected shared memory block.
          * @throws runtime_error If failed to decode header information or memory size is smaller than
-         *                       size needed according to the header.
+         *                       size needed according to the header, or the picture is encoded.
          * @return Picture in the shared memory block.
+         * @details
+         *  For a ring layout block, the newest complete picture is returned and its slot is held
+         *  until the next read, an empty picture is returned if no picture has been published yet.
+         *  If the writer has resized the block, the reader moves to the new block transparently.
+         *  Rows of a picture in the ring layout may be padded, the row stride is recorded in the picture step.
          */
         cv::Mat Read();
+
+        /**
+         * @brief Read a downsampled level of the newest picture without copying it.
+         * @param level Level to read, 0 is the picture itself, level N is 1 / 2^N of its width and height.
+         * @throws runtime_error If the block is not in the ring layout, or the picture has no such level.
+         * @return Level picture in the shared memory block, its slot is held like Read().
+         * @details Levels are published by writers of blocks with BlockOptions::PyramidLevels.
+         */
+        cv::Mat Read(unsigned int level);
+
+        /**
+         * @brief Read the newest picture with its metadata, see Read().
+         * @param metadata Metadata of the picture, empty if the block is in the single layout or nothing is published.
+         */
+        cv::Mat Read(FrameMetadata& metadata);
+
+        /**
+         * @brief Read a copy of the newest picture owned by the caller.
+         * @param picture Caller owned picture to copy into, its buffer is reused if it has the same shape and type.
+         * @throws runtime_error If failed to read the picture like Read().
+         * @details
+         *  Pictures encoded by the writer are decoded into the given picture.
+         *  The copy is continuous and is made by the default CopyEngine, so big pictures are copied
+         *  by its thread pool. For a ring layout block, the slot is held only while it is being copied,
+         *  or the copy is retried like TryRead() if the block is opened in read-only mode.
+         *  The given picture is released if no picture has been published yet.
+         */
+        void ReadCopy(cv::Mat& picture);
+
+        /// Read a copy of the newest picture, see ReadCopy(cv::Mat&).
+        cv::Mat ReadCopy();
+
+        /**
+         * @brief Read the newest picture converted into the given format, such as the input format of a model.
+         * @param picture Caller owned picture to convert into, its buffer is reused if it has the same shape and type.
+         * @param format Target channel order, depth, scale, offset and layout.
+         * @throws runtime_error If failed to read the picture like ReadCopy(), or the conversion is not supported.
+         * @details
+         *  The picture is converted straight from the shared memory in one pass by PictureConverter,
+         *  instead of a copy followed by a pass for every conversion step.
+         *  The slot is held like ReadCopy(), and the given picture is released if no picture has been published yet.
+         */
+        void ReadConverted(cv::Mat& picture, const ConversionFormat& format);
+
+        /**
+         * @brief Read a batch of pictures written by PictureWriter::Write(const std::vector<cv::Mat>&).
+         * @return Pictures of the batch, aliasing the slot held like Read(), empty if nothing is published yet.
+         * @throws runtime_error If the published picture has only 2 dimensions.
+         */
+        std::vector<cv::Mat> ReadBatch();
+
+        /**
+         * @brief Hold the newest picture of a ring layout block with a lease.
+         * @return Lease of the slot of the newest picture, or an empty lease if no picture has been published yet.
+         * @throws runtime_error If the block is not in the ring layout, is in the queue mode,
+         *                       or is opened in read-only mode, or the picture is encoded.
+         * @details
+         *  The writer skips a leased slot until the lease is destroyed, so the leased picture can be processed
+         *  without copying and without tearing. Every lease takes a slot, the ring layout needs at least
+         *  (count of leases held at the same time + 2) slots to never refuse the writer.
+         */
+        ReadLease Lease();
+        /**
+         * @brief Hold the newest picture of a ring layout block with a lease, without decoding encoded pictures.
+         * @return Lease of the slot of the newest picture, or an empty lease if no picture has been published yet.
+         * @throws runtime_error Like Lease(), except for encoded pictures.
+         * @details
+         *  Raw pictures are leased like Lease(). The lease of an encoded picture has no picture,
+         *  and gives its header, codec and encoded bytes instead, so they can be forwarded without decoding.
+         */
+        ReadLease LeaseEncoded();
+
+        /**
+         * @brief Copy the newest picture out if it is newer than the given sequence number.
+         * @param last_sequence Sequence number of the last picture the caller has got.
+         * @param picture Caller owned picture to copy or decode into,
+         *                its buffer is reused if it has the same size and type.
+         * @param sequence Sequence number of the copied picture.
+         * @param metadata Metadata to copy the metadata of the picture into, consistent with the picture, or null.
+         * @retval true A consistent copy of a newer picture is written into the given picture.
+         * @retval false No newer picture is published, pixel memory is not touched.
+         * @throws runtime_error If the block is not in the ring layout or the header information is broken.
+         * @details
+         *  This function does not hold any slot, the copy is retried if the writer
+         *  has changed the picture while it is being copied, so it works in read-only mode.
+         */
+        bool TryRead(std::uint64_t last_sequence, cv::Mat& picture, std::uint64_t& sequence,
+                     FrameMetadata* metadata = nullptr);
+
+        /**
+         * @brief Copy the newest picture out if it is newer than the last picture read by this reader.
+         * @param picture Caller owned picture to copy into.
+         * @retval true A newer picture is copied.
+         * @retval false No newer picture is published.
+         */
+        bool ReadIfNewer(cv::Mat& picture);
+
+        /**
+         * @brief Wait until a picture newer than the last read one is published, then read it.
+         * @param timeout Max time to wait.
+         * @return The newest picture like Read(), or an empty picture if the timeout is reached.
+         * @throws runtime_error If the block is not in the ring layout or is opened in read-only mode.
+         * @details Waiting readers are blocked on a process-shared notification word and cost no CPU.
+         */
+        cv::Mat WaitNext(std::chrono::microseconds timeout);
+
+        /**
+         * @brief Get a descriptor which becomes readable when pictures are published, for epoll, poll or asio.
+         * @details
+         *  The descriptor stays readable until ClearReadiness() is called, so event loops clear it before reading
+         *  with ReadIfNewer(), TryRead() or Dequeue(); it is owned by this reader and follows the resized block.
+         * @throws runtime_error If the block is not in the ring layout or is opened in read-only mode,
+         *                       all subscription entries of the block are taken, or the platform is not Linux.
+         */
+        int GetReadinessDescriptor();
+        /// Discard the pending notifications of the readiness descriptor.
+        void ClearReadiness();
+
+        /**
+         * @brief Consume the next picture of a block in the queue mode, in the order they are published.
+         * @param picture Caller owned picture to copy or decode into.
+         * @param dropped Count of pictures overwritten by the writer before they are consumed by this call.
+         * @param timeout Max time to wait for a picture if the queue of this reader is empty.
+         * @param metadata Metadata to copy the metadata of the picture into, or null.
+         * @retval true The next picture is consumed.
+         * @retval false No picture is published before the timeout is reached.
+         * @throws runtime_error If the block is not in the queue mode or is opened in read-only mode,
+         *                       or all reader cursors are registered.
+         * @details
+         *  A reader cursor is registered on the first call, pictures published before it are not consumed.
+         *  Cursors are only written by their own readers, so the writer never waits for slow readers;
+         *  a reader lapped by the writer skips to the oldest picture still in the queue.
+         */
+        bool Dequeue(cv::Mat& picture, std::uint64_t& dropped,
+                     std::chrono::microseconds timeout = std::chrono::microseconds(0),
+                     FrameMetadata* metadata = nullptr);
+
+        /**
+         * @brief Consume up to the given count of pictures already published, without waiting.
+         * @param pictures Caller owned pictures to copy or decode into, resized to the count of consumed pictures.
+         * @param max_count Max count of pictures to consume.
+         * @param dropped Count of pictures overwritten by the writer before they are consumed by this call.
+         * @return Count of consumed pictures.
+         * @throws runtime_error Like Dequeue().
+         */
+        std::size_t DequeueBatch(std::vector<cv::Mat>& pictures, std::size_t max_count, std::uint64_t& dropped);
+
+        /// Get the count of pictures dropped by this reader in the queue mode since its cursor is registered.
+        [[nodiscard]] std::uint64_t GetDroppedCount() const;
+
+        /**
+         * @brief Get the statistics of the block, which are updated by the writer and all writable readers.
+         * @return Statistics in the shared memory, or null if the block is not in the ring layout.
+         */
+        [[nodiscard]] const BlockStatistics* GetStatistics() const;
+
+        /**
+         * @brief Get the tiles of the last read picture which have changed since the given picture.
+         * @param since_sequence Sequence number of the picture the caller has processed.
+         * @param tiles Regions of the changed tiles, clipped to the picture, empty if nothing has changed.
+         * @retval true The changed tiles are known.
+         * @retval false The changes are unknown and the whole picture must be treated as changed,
+         *               for pictures in between are overwritten, or differ in size or type, or are not written
+         *               by PictureWriter::Write(const cv::Mat&).
+         * @throws runtime_error If the block is not in the ring layout or has no tiles.
+         * @details Every picture records its changes since the previous one, which are merged back to the given one.
+         */
+        bool GetChangedTiles(std::uint64_t since_sequence, std::vector<cv::Rect>& tiles);
     };
 }
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "PictureRecorder.hpp"
+#include "PictureCopier.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Gaia::SharedPicture
+{
+    /// Create or truncate a recording file.
+    PictureRecorder::PictureRecorder(const std::string &path, std::size_t initial_capacity) : Path(path)
+    {
+        Descriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (Descriptor < 0)
+        {
+            throw std::runtime_error("Failed to create recording file " + path + ": " + std::strerror(errno));
+        }
+        try
+        {
+            Reserve(std::max(initial_capacity, sizeof(RecordingHeader)));
+        }catch(...)
+        {
+            ::close(Descriptor);
+            throw;
+        }
+        new (RegionObject->get_address()) RecordingHeader;
+    }
+
+    /// Close the recording.
+    PictureRecorder::~PictureRecorder()
+    {
+        try
+        {
+            Close();
+        }catch(std::exception&)
+        {}
+    }
+
+    /// Grow the file and its mapping to hold at least the given bytes.
+    void PictureRecorder::Reserve(std::size_t size)
+    {
+        if (size <= Capacity) return;
+        auto capacity = std::max(size, Capacity * 2);
+        // Unmap before resizing, the new mapping is made on the grown file.
+        RegionObject.reset();
+        if (::ftruncate(Descriptor, static_cast<off_t>(capacity)) != 0)
+        {
+            throw std::runtime_error("Failed to resize recording file " + Path + ": " + std::strerror(errno));
+        }
+        if (!FileObject)
+        {
+            FileObject = std::make_unique<boost::interprocess::file_mapping>(Path.c_str(),
+                                                                             boost::interprocess::read_write);
+        }
+        RegionObject = std::make_unique<boost::interprocess::mapped_region>(
+                *FileObject, boost::interprocess::read_write, 0, capacity);
+        Capacity = capacity;
+    }
+
+    /// Record the next picture of the reader if it is newer than the last recorded one.
+    bool PictureRecorder::Record(PictureReader &reader)
+    {
+        if (!RegionObject)
+        {
+            throw std::runtime_error("Failed to record picture, the recording is closed.");
+        }
+        // The picture bytes of the next record are the destination of the copy, in the shape of the last picture;
+        // the copy reallocates the destination out of the file if the picture has another shape.
+        cv::Mat picture;
+        if (auto picture_size = HeaderCoder::GetPictureSize(LastHeader); picture_size != 0)
+        {
+            Reserve(DataEnd + BlockLayout::AlignSize(sizeof(RecordHeader) + picture_size, RecordAlignment));
+            auto* memory = static_cast<unsigned char*>(RegionObject->get_address());
+            picture = HeaderCoder::GetPicture(LastHeader, memory + DataEnd + sizeof(RecordHeader));
+        }
+        auto* in_place = picture.data;
+
+        FrameMetadata metadata;
+        std::uint64_t sequence;
+        if (reader.IsQueue())
+        {
+            std::uint64_t dropped;
+            if (!reader.Dequeue(picture, dropped, std::chrono::microseconds(0), &metadata)) return false;
+            sequence = reader.GetLastSequence();
+        }
+        else if (!reader.TryRead(LastSequence, picture, sequence, &metadata)) return false;
+        LastSequence = sequence;
+        if (in_place && picture.data == in_place) CommitRecord(LastHeader, metadata, sequence);
+        else Append(picture, metadata, sequence);
+        return true;
+    }
+
+    /// Append a picture to the recording.
+    void PictureRecorder::Append(const cv::Mat &picture, const FrameMetadata &metadata, std::uint64_t sequence)
+    {
+        if (!RegionObject)
+        {
+            throw std::runtime_error("Failed to record picture, the recording is closed.");
+        }
+        if (picture.empty())
+        {
+            throw std::runtime_error("Failed to record picture, the picture is empty.");
+        }
+        auto header = HeaderCoder::GetHeader(picture);
+        auto picture_size = HeaderCoder::GetPictureSize(header);
+        auto record_size = BlockLayout::AlignSize(sizeof(RecordHeader) + picture_size, RecordAlignment);
+        Reserve(DataEnd + record_size);
+
+        auto destination = HeaderCoder::GetPicture(
+                header, static_cast<unsigned char*>(RegionObject->get_address()) + DataEnd + sizeof(RecordHeader));
+        PictureCopier::Copy(picture, destination);
+        CommitRecord(header, metadata, sequence);
+    }
+
+    /// Write the header of the record at the end of the data, whose picture bytes are already written.
+    void PictureRecorder::CommitRecord(const PictureHeader &header, const FrameMetadata &metadata,
+                                       std::uint64_t sequence)
+    {
+        auto picture_size = HeaderCoder::GetPictureSize(header);
+        auto record_size = BlockLayout::AlignSize(sizeof(RecordHeader) + picture_size, RecordAlignment);
+        auto* memory = static_cast<unsigned char*>(RegionObject->get_address());
+        auto* record = new (memory + DataEnd) RecordHeader;
+        record->Sequence = sequence;
+        record->RecordTime = BlockLayout::GetTimeStamp();
+        record->PictureSize = picture_size;
+        HeaderCoder::EncodeExtended(header, record->Picture);
+        record->Metadata = metadata;
+        // The size is written last, so a recording which is not closed ends at the last complete record.
+        record->Size = record_size;
+
+        Offsets.push_back(DataEnd);
+        DataEnd += record_size;
+        reinterpret_cast<RecordingHeader*>(memory)->DataEnd = DataEnd;
+        LastHeader = header;
+    }
+
+    /// Write the index, truncate the file to its content and unmap it.
+    void PictureRecorder::Close()
+    {
+        if (Descriptor < 0) return;
+        auto index_size = Offsets.size() * sizeof(std::uint64_t);
+        auto size = DataEnd + index_size;
+        bool indexed = false;
+        try
+        {
+            Reserve(size);
+            auto* memory = static_cast<unsigned char*>(RegionObject->get_address());
+            if (index_size != 0) std::memcpy(memory + DataEnd, Offsets.data(), index_size);
+            auto* recording = reinterpret_cast<RecordingHeader*>(memory);
+            recording->RecordCount = Offsets.size();
+            recording->IndexOffset = DataEnd;
+            indexed = true;
+        }catch(std::exception&)
+        {}
+        RegionObject.reset();
+        FileObject.reset();
+        // Without the index, the file keeps its zeroed tail, where the walk over the records stops.
+        auto result = indexed ? ::ftruncate(Descriptor, static_cast<off_t>(size)) : 0;
+        auto error = errno;
+        ::close(Descriptor);
+        Descriptor = -1;
+        if (!indexed || result != 0)
+        {
+            throw std::runtime_error("Failed to close recording file " + Path + ": " + std::strerror(error));
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "PictureReader.hpp"
+#include "RecordingLayout.hpp"
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Picture recorder appending pictures into a memory-mapped recording file, see RecordingLayout.hpp.
+     * @details
+     *  Pictures are copied once into the mapped file, with their headers, sequence numbers and metadata:
+     *  Record() copies a picture under the sequence lock straight into the next record when it has the shape
+     *  of the last recorded picture, so only the first picture of a shape is copied twice.
+     *  The file grows by doubling its mapping; the index is written by Close(), and the recording
+     *  can be replayed by PictureReplayer even if it is not closed.
+     */
+    class PictureRecorder
+    {
+        /// Path of the recording file.
+        std::string Path;
+        /// Descriptor of the recording file, used to resize it.
+        int Descriptor {-1};
+        /// File mapping management object.
+        std::unique_ptr<boost::interprocess::file_mapping> FileObject;
+        /// Mapped region of the whole file.
+        std::unique_ptr<boost::interprocess::mapped_region> RegionObject;
+        /// Bytes of the file.
+        std::size_t Capacity {0};
+        /// Offsets of the records.
+        std::vector<std::uint64_t> Offsets;
+        /// Offset of the end of the last record.
+        std::uint64_t DataEnd {sizeof(RecordingHeader)};
+        /// Sequence number of the last picture recorded by Record().
+        std::uint64_t LastSequence {0};
+        /// Header of the last recorded picture, the shape of the record Record() copies the next picture into.
+        PictureHeader LastHeader;
+
+        /// Grow the file and its mapping to hold at least the given bytes.
+        void Reserve(std::size_t size);
+        /// Write the header of the record at the end of the data, whose picture bytes are already written.
+        void CommitRecord(const PictureHeader& header, const FrameMetadata& metadata, std::uint64_t sequence);
+
+    public:
+        /**
+         * @brief Create or truncate a recording file.
+         * @param path Path of the recording file.
+         * @param initial_capacity Bytes of the file to map at first, it is doubled when it is full.
+         * @throws runtime_error If the file can not be created or mapped.
+         */
+        explicit PictureRecorder(const std::string& path, std::size_t initial_capacity = std::size_t(64) << 20);
+        PictureRecorder(const PictureRecorder&) = delete;
+        PictureRecorder& operator=(const PictureRecorder&) = delete;
+        /// Close the recording.
+        ~PictureRecorder();
+
+        /**
+         * @brief Record the next picture of the reader if it is newer than the last recorded one.
+         * @param reader Reader of a ring layout block, which may be opened in read-only mode;
+         *               readers of a block in the queue mode consume the queue.
+         * @retval true A picture is recorded.
+         * @retval false No newer picture is published.
+         * @throws runtime_error If the block is not in the ring layout, or the file can not be grown.
+         * @details
+         *  Pictures are copied out under the sequence lock, so the recorder never holds slots; a picture with
+         *  the shape of the last recorded one is copied straight into the file, others are copied twice.
+         */
+        bool Record(PictureReader& reader);
+
+        /**
+         * @brief Append a picture to the recording.
+         * @param picture Picture to append, it may have padded rows or be a region of interest.
+         * @param metadata Metadata of the picture.
+         * @param sequence Sequence number of the picture.
+         * @throws runtime_error If the picture is empty, or the file can not be grown.
+         */
+        void Append(const cv::Mat& picture, const FrameMetadata& metadata = FrameMetadata(), std::uint64_t sequence = 0);
+
+        /// Get the count of recorded pictures.
+        [[nodiscard]] inline std::size_t GetRecordCount() const noexcept
+        {
+            return Offsets.size();
+        }
+        /// Get the bytes of the recording so far.
+        [[nodiscard]] inline std::uint64_t GetDataSize() const noexcept
+        {
+            return DataEnd;
+        }
+
+        /// Write the index, truncate the file to its content and unmap it; nothing can be recorded after it.
+        void Close();
+    };
+}
\ No newline at end of file
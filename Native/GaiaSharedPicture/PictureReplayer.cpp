@@ -0,0 +1,127 @@
+#include "PictureReplayer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace Gaia::SharedPicture
+{
+    /// Open a recording file.
+    PictureReplayer::PictureReplayer(const std::string &path)
+    {
+        try
+        {
+            FileObject = std::make_unique<boost::interprocess::file_mapping>(path.c_str(),
+                                                                             boost::interprocess::read_only);
+            RegionObject = std::make_unique<boost::interprocess::mapped_region>(*FileObject,
+                                                                                boost::interprocess::read_only);
+        }catch(boost::interprocess::interprocess_exception& error)
+        {
+            throw std::runtime_error("Failed to open recording file " + path + ": " + error.what());
+        }
+        const auto* memory = static_cast<const unsigned char*>(RegionObject->get_address());
+        auto size = RegionObject->get_size();
+        const auto* recording = reinterpret_cast<const RecordingHeader*>(memory);
+        if (size < sizeof(RecordingHeader) || recording->Magic != RecordingMagic ||
+            recording->Version != RecordingVersion)
+        {
+            throw std::runtime_error("Failed to open recording file " + path + ": it is not a recording file.");
+        }
+
+        if (recording->IndexOffset != 0 && recording->IndexOffset <= size &&
+            recording->RecordCount <= (size - recording->IndexOffset) / sizeof(std::uint64_t))
+        {
+            Offsets.resize(recording->RecordCount);
+            std::memcpy(Offsets.data(), memory + recording->IndexOffset, Offsets.size() * sizeof(std::uint64_t));
+        }
+        else
+        {
+            // The recording is not closed, walk its records up to the first incomplete one.
+            std::uint64_t offset = sizeof(RecordingHeader);
+            auto end = std::min<std::uint64_t>(size, recording->DataEnd);
+            while (offset + sizeof(RecordHeader) <= end)
+            {
+                auto record_size = reinterpret_cast<const RecordHeader*>(memory + offset)->Size;
+                if (record_size < sizeof(RecordHeader) || record_size > end - offset) break;
+                Offsets.push_back(offset);
+                offset += record_size;
+            }
+        }
+    }
+
+    /// Get the header of the record with the given index.
+    const RecordHeader *PictureReplayer::GetRecord(std::size_t index) const
+    {
+        if (index >= Offsets.size())
+        {
+            throw std::runtime_error("Failed to read recorded picture, the index is out of range.");
+        }
+        auto offset = Offsets[index];
+        const auto* memory = static_cast<const unsigned char*>(RegionObject->get_address());
+        const auto* record = reinterpret_cast<const RecordHeader*>(memory + offset);
+        if (offset % RecordAlignment != 0 || offset + sizeof(RecordHeader) > RegionObject->get_size() ||
+            record->Size < sizeof(RecordHeader) + record->PictureSize ||
+            record->Size > RegionObject->get_size() - offset)
+        {
+            throw std::runtime_error("Failed to read recorded picture, the record is broken.");
+        }
+        return record;
+    }
+
+    /// Get a recorded picture.
+    cv::Mat PictureReplayer::GetPicture(std::size_t index, FrameMetadata *metadata) const
+    {
+        const auto* record = GetRecord(index);
+        PictureHeader header;
+        if (!HeaderCoder::DecodeExtended(record->Picture, header) ||
+            HeaderCoder::GetPictureSize(header) != record->PictureSize)
+        {
+            throw std::runtime_error("Failed to read recorded picture, header information decoding failed.");
+        }
+        if (metadata) *metadata = record->Metadata;
+        auto* data = reinterpret_cast<const unsigned char*>(record) + sizeof(RecordHeader);
+        return HeaderCoder::GetPicture(header, const_cast<unsigned char*>(data));
+    }
+
+    /// Get the sequence number of a recorded picture in the recorded block.
+    std::uint64_t PictureReplayer::GetSequence(std::size_t index) const
+    {
+        return GetRecord(index)->Sequence;
+    }
+
+    /// Get the time stamp in nanoseconds of the steady clock when a picture is recorded.
+    std::int64_t PictureReplayer::GetRecordTime(std::size_t index) const
+    {
+        return GetRecord(index)->RecordTime;
+    }
+
+    /// Replay recorded pictures into the writer.
+    std::size_t PictureReplayer::Replay(PictureWriter &writer, double speed, std::size_t first,
+                                        std::size_t count) const
+    {
+        if (first >= Offsets.size()) return 0;
+        auto last = first + std::min(count, Offsets.size() - first);
+        bool ring = writer.GetOptions().Layout == BlockOptions::Layouts::Ring;
+        auto first_time = GetRecordTime(first);
+        auto start = std::chrono::steady_clock::now();
+        std::size_t published = 0;
+        FrameMetadata metadata;
+        for (auto index = first; index < last; ++index)
+        {
+            auto picture = GetPicture(index, &metadata);
+            if (speed > 0)
+            {
+                auto offset = std::chrono::nanoseconds(static_cast<std::int64_t>(
+                        static_cast<double>(GetRecordTime(index) - first_time) / speed));
+                std::this_thread::sleep_until(start + offset);
+            }
+            // Capture time stamps are moved to the replay, keeping their distance to the recording.
+            if (metadata.CaptureTime != 0)
+                metadata.CaptureTime += BlockLayout::GetTimeStamp() - GetRecordTime(index);
+            if (ring ? writer.Write(picture, metadata) : writer.Write(picture)) ++published;
+        }
+        return published;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "PictureWriter.hpp"
+#include "RecordingLayout.hpp"
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Picture replayer reading a recording file of PictureRecorder through a read-only mapping.
+     * @details Recorded pictures alias the mapped file, so replaying them only copies them into the writer.
+     */
+    class PictureReplayer
+    {
+        /// File mapping management object.
+        std::unique_ptr<boost::interprocess::file_mapping> FileObject;
+        /// Mapped region of the whole file.
+        std::unique_ptr<boost::interprocess::mapped_region> RegionObject;
+        /// Offsets of the records.
+        std::vector<std::uint64_t> Offsets;
+
+        /// Get the header of the record with the given index.
+        [[nodiscard]] const RecordHeader* GetRecord(std::size_t index) const;
+
+    public:
+        /**
+         * @brief Open a recording file.
+         * @param path Path of the recording file.
+         * @throws runtime_error If the file can not be mapped, or it is not a recording file.
+         * @details A recording which is not closed is indexed by walking its complete records.
+         */
+        explicit PictureReplayer(const std::string& path);
+
+        /// Get the count of recorded pictures.
+        [[nodiscard]] inline std::size_t GetRecordCount() const noexcept
+        {
+            return Offsets.size();
+        }
+
+        /**
+         * @brief Get a recorded picture.
+         * @param index Index of the record.
+         * @param metadata Metadata to copy the metadata of the picture into, or null to skip it.
+         * @return Picture aliasing the mapped file, valid as long as this replayer, which must not be written.
+         * @throws runtime_error If the index is out of range, or the record is broken.
+         */
+        [[nodiscard]] cv::Mat GetPicture(std::size_t index, FrameMetadata* metadata = nullptr) const;
+        /// Get the sequence number of a recorded picture in the recorded block.
+        [[nodiscard]] std::uint64_t GetSequence(std::size_t index) const;
+        /// Get the time stamp in nanoseconds of the steady clock when a picture is recorded.
+        [[nodiscard]] std::int64_t GetRecordTime(std::size_t index) const;
+
+        /**
+         * @brief Replay recorded pictures into the writer.
+         * @param writer Writer to publish the pictures with, with their metadata in the ring layout.
+         * @param speed Speed relative to the recording, 1 replays at the recorded pace, 0 replays at max speed.
+         * @param first Index of the first record to replay.
+         * @param count Max count of records to replay.
+         * @return Count of published pictures, pictures refused for all ring layout slots are held are skipped.
+         * @throws runtime_error If a record is broken, or the writer fails to write a picture.
+         */
+        std::size_t Replay(PictureWriter& writer, double speed = 1.0, std::size_t first = 0,
+                           std::size_t count = std::numeric_limits<std::size_t>::max()) const;
+    };
+}
\ No newline at end of file
@@ -1,5 +1,15 @@
 #include "PictureWriter.hpp"
 #include "HeaderCoder.hpp"
+#include "Notifier.hpp"
+#include "CopyEngine.hpp"
+#include "PictureCopier.hpp"
+#include "PictureDownsampler.hpp"
+#include "PayloadCodec.hpp"
+#include "ReadinessChannel.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 namespace Gaia::SharedPicture
 {
@@ -10,77 +20,700 @@ namespace Gaia::SharedPicture
         if (OwnedMemory)
         {
             if (MemoryObject) boost::interprocess::shared_memory_object::remove(MemoryObject->get_name());
+            if (FileObject) boost::interprocess::file_mapping::remove(FileObject->get_name());
+            if (BaseMemoryObject) boost::interprocess::shared_memory_object::remove(BaseMemoryObject->get_name());
             RegionObject.reset();
             MemoryObject.reset();
+            FileObject.reset();
+            BaseRegionObject.reset();
+            BaseMemoryObject.reset();
         }
     }
 
     /// Connect to the shared memory block.
-    PictureWriter::PictureWriter(const std::string& shared_block_name, unsigned int max_size, bool create):
-        MaxSize(max_size), OwnedMemory(!create)
+    PictureWriter::PictureWriter(const std::string& shared_block_name, unsigned int max_size, bool create,
+                                 const BlockOptions& options, const MappingOptions& mapping):
+        MaxSize(max_size), OwnedMemory(!create), Options(options), Mapping(mapping), BlockName(shared_block_name)
     {
-        MemoryObject = std::make_unique<boost::interprocess::shared_memory_object>(
-                boost::interprocess::open_or_create, shared_block_name.c_str(),
-                boost::interprocess::read_write);
+        if (create) CheckOptions();
+        if (create && Options.Resizable && !Mapping.HugePageDirectory.empty())
+            throw std::runtime_error("Failed to create shared picture: resizable blocks require POSIX shared memory.");
+        auto block_size = GetBlockSize(max_size, Options);
+        if (Mapping.HugePageDirectory.empty())
+        {
+            MemoryObject = std::make_unique<boost::interprocess::shared_memory_object>(
+                    boost::interprocess::open_or_create, shared_block_name.c_str(),
+                    boost::interprocess::read_write);
+            if (create) MemoryObject->truncate(static_cast<boost::interprocess::offset_t>(block_size));
+            RegionObject = std::make_shared<boost::interprocess::mapped_region>(
+                    *MemoryObject,
+                    boost::interprocess::read_write);
+        }
+        else
+        {
+            auto path = BlockMapping::GetHugePagePath(Mapping, shared_block_name);
+            if (create) BlockMapping::CreateHugePageFile(Mapping, path, block_size);
+            FileObject = std::make_unique<boost::interprocess::file_mapping>(
+                    path.c_str(), boost::interprocess::read_write);
+            RegionObject = std::make_shared<boost::interprocess::mapped_region>(
+                    *FileObject,
+                    boost::interprocess::read_write);
+        }
+        InitializeBlock(create);
+        if (!create && MemoryObject) FollowGeneration();
+    }
+
+    /// Get the bytes of a memory block holding pictures of the given size in the given layout.
+    std::size_t PictureWriter::GetBlockSize(unsigned int max_picture_size, const BlockOptions &options)
+    {
+        if (options.Layout == BlockOptions::Layouts::Ring)
+            return BlockLayout::GetBlockSize(options.SlotCount, max_picture_size, options.PayloadAlignment,
+                                             options.QueueMode ? options.MaxQueueReaders : 0, options.PyramidLevels);
+        return static_cast<std::size_t>(max_picture_size) + 10;
+    }
+
+    /// Check the layout options of a memory block to create.
+    void PictureWriter::CheckOptions() const
+    {
+        if (Options.Layout != BlockOptions::Layouts::Ring)
+        {
+            if (Options.Resizable || Options.PyramidLevels != 0 || Options.TileSize != 0)
+                throw std::runtime_error("Failed to create shared picture: resizable blocks, pyramids and tiles "
+                                         "require the ring layout.");
+            return;
+        }
+        if (Options.SlotCount < 2)
+            throw std::runtime_error("Failed to create shared picture: ring layout requires at least 2 slots.");
+        if (Options.PayloadAlignment == 0 || (Options.PayloadAlignment & (Options.PayloadAlignment - 1)) != 0 ||
+            Options.RowAlignment == 0 || (Options.RowAlignment & (Options.RowAlignment - 1)) != 0)
+            throw std::runtime_error("Failed to create shared picture: alignments must be powers of 2.");
+        if (Options.QueueMode && (Options.Resizable || Options.MaxQueueReaders == 0))
+            throw std::runtime_error("Failed to create shared picture: the queue mode requires readers "
+                                     "and can not be resizable.");
+        if (Options.PyramidLevels > MaxPyramidLevels)
+            throw std::runtime_error("Failed to create shared picture: at most " + std::to_string(MaxPyramidLevels) +
+                                     " pyramid levels are supported.");
+    }
+
+    /// Prepare the mapped memory block, then initialize it or read its layout options.
+    void PictureWriter::InitializeBlock(bool create)
+    {
+        BlockMapping::Prepare(GetMemoryPointer(), GetMemorySize(), Mapping, create);
         if (create)
         {
-            MemoryObject->truncate(max_size + 10);
+            if (Options.Layout == BlockOptions::Layouts::Ring)
+                BlockLayout::Initialize(GetMemoryPointer(), Options.SlotCount, MaxSize,
+                                        Options.PayloadAlignment, Options.RowAlignment,
+                                        Options.QueueMode ? Options.MaxQueueReaders : 0, Options.PyramidLevels,
+                                        Options.TileSize);
+        }
+        else if (BlockLayout::IsRing(GetMemoryPointer(), GetMemorySize()))
+        {
+            Options.Layout = BlockOptions::Layouts::Ring;
+            auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+            Options.SlotCount = block->SlotCount;
+            Options.PayloadAlignment = block->PayloadAlignment;
+            Options.RowAlignment = block->RowAlignment;
+            Options.QueueMode = block->QueueReaders != 0;
+            if (Options.QueueMode) Options.MaxQueueReaders = block->QueueReaders;
+            Options.PyramidLevels = block->PyramidLevels;
+            Options.TileSize = block->TileSize;
+        }
+        else
+        {
+            Options.Layout = BlockOptions::Layouts::Single;
         }
-        RegionObject = std::make_unique<boost::interprocess::mapped_region>(
-                *MemoryObject,
-                boost::interprocess::read_write);
     }
 
     /// Copy constructor.
     PictureWriter::PictureWriter(PictureWriter &&target) noexcept:
-        MaxSize(target.MaxSize), OwnedMemory(target.OwnedMemory),
-        MemoryObject(std::move(target.MemoryObject)), RegionObject(std::move(target.RegionObject))
-    {}
+        MaxSize(target.MaxSize), OwnedMemory(target.OwnedMemory), Options(target.Options),
+        Mapping(std::move(target.Mapping)),
+        MemoryObject(std::move(target.MemoryObject)), FileObject(std::move(target.FileObject)),
+        BlockName(std::move(target.BlockName)), BaseMemoryObject(std::move(target.BaseMemoryObject)),
+        BaseRegionObject(std::move(target.BaseRegionObject)),
+        RegionObject(std::move(target.RegionObject)), RegionOffset(target.RegionOffset), RegionSize(target.RegionSize),
+        PendingSlot(target.PendingSlot), Pending(target.Pending), PendingContent(target.PendingContent),
+        PendingTime(target.PendingTime),
+        Codec(target.Codec)
+    {
+        target.Pending = false;
+    }
 
     PictureWriter::PictureWriter(const PictureWriter &target):
-        MaxSize(target.MaxSize), OwnedMemory(false)
+        MaxSize(target.MaxSize), OwnedMemory(false), Options(target.Options), Mapping(target.Mapping),
+        BlockName(target.BlockName), Codec(target.Codec)
     {
         if (target.MemoryObject)
         {
             MemoryObject = std::make_unique<boost::interprocess::shared_memory_object>(
                     boost::interprocess::open_only, target.MemoryObject->get_name(),
                     boost::interprocess::read_write);
-            RegionObject = std::make_unique<boost::interprocess::mapped_region>(
+            RegionObject = std::make_shared<boost::interprocess::mapped_region>(
                     *MemoryObject,
                     boost::interprocess::read_write);
+            if (target.BaseRegionObject)
+            {
+                BaseMemoryObject = std::make_unique<boost::interprocess::shared_memory_object>(
+                        boost::interprocess::open_only, target.BaseMemoryObject->get_name(),
+                        boost::interprocess::read_write);
+                BaseRegionObject = std::make_shared<boost::interprocess::mapped_region>(
+                        *BaseMemoryObject,
+                        boost::interprocess::read_write);
+            }
+        }
+        else if (target.FileObject)
+        {
+            FileObject = std::make_unique<boost::interprocess::file_mapping>(
+                    target.FileObject->get_name(), boost::interprocess::read_write);
+            RegionObject = std::make_shared<boost::interprocess::mapped_region>(
+                    *FileObject,
+                    boost::interprocess::read_write);
+        }
+        else
+        {
+            // Writers of an arena stream share the mapping of the arena.
+            RegionObject = target.RegionObject;
+            RegionOffset = target.RegionOffset;
+            RegionSize = target.RegionSize;
         }
     }
 
+    /// Construct a writer on a memory block in a mapped region shared with other pictures.
+    PictureWriter::PictureWriter(std::shared_ptr<boost::interprocess::mapped_region> region, std::size_t offset,
+                                 std::size_t size, unsigned int max_size, bool create, const BlockOptions &options):
+        MaxSize(max_size), OwnedMemory(false), Options(options),
+        RegionObject(std::move(region)), RegionOffset(offset), RegionSize(size)
+    {
+        if (create) CheckOptions();
+        InitializeBlock(create);
+    }
+
     /// Release the memory if it owns the memory.
     PictureWriter::~PictureWriter()
     {
         Release();
     }
 
-    /// Write a cv::Mat into shared memory block.
-    bool PictureWriter::Write(const cv::Mat &picture)
+    /// Move to a bigger block of the next generation, which can hold pictures of the given size.
+    void PictureWriter::Resize(std::size_t required_size)
     {
-        if (RegionObject && RegionObject->get_address())
+        if (Options.Layout != BlockOptions::Layouts::Ring || !MemoryObject || BlockName.empty())
+            throw std::runtime_error("Failed to resize shared picture: only ring layout blocks in POSIX shared memory "
+                                     "can be resized.");
+        // Grow by at least a half, so a slowly growing picture does not create a generation per frame.
+        auto max_size = std::max<std::size_t>(required_size, static_cast<std::size_t>(MaxSize) + MaxSize / 2);
+        if (max_size > std::numeric_limits<unsigned int>::max())
+            throw std::runtime_error("Failed to resize shared picture: " + std::to_string(max_size) +
+                                     " bytes exceed the max size.");
+
+        auto* old_block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        auto generation = old_block->Generation + 1;
+        auto memory = std::make_unique<boost::interprocess::shared_memory_object>(
+                boost::interprocess::open_or_create, BlockLayout::GetGenerationName(BlockName, generation).c_str(),
+                boost::interprocess::read_write);
+        memory->truncate(static_cast<boost::interprocess::offset_t>(
+                GetBlockSize(static_cast<unsigned int>(max_size), Options)));
+        auto region = std::make_shared<boost::interprocess::mapped_region>(
+                *memory,
+                boost::interprocess::read_write);
+        BlockMapping::Prepare(region->get_address(), region->get_size(), Mapping, true);
+        auto* block = BlockLayout::Initialize(static_cast<unsigned char*>(region->get_address()), Options.SlotCount,
+                                              max_size, Options.PayloadAlignment, Options.RowAlignment,
+                                              0, Options.PyramidLevels, Options.TileSize);
+        block->Generation = generation;
+        // Sequence numbers continue, so readers keep comparing them with the ones they have read.
+        block->Sequence.store(old_block->Sequence.load());
+
+        // The base block always points to the newest generation, for retired blocks of other generations
+        // are removed, and it is updated before the retired block, where readers notice the change.
+        if (!BaseRegionObject)
+        {
+            BaseMemoryObject = std::move(MemoryObject);
+            BaseRegionObject = RegionObject;
+        }
+        else
+        {
+            boost::interprocess::shared_memory_object::remove(MemoryObject->get_name());
+        }
+        BlockLayout::GetBlockHeader(static_cast<unsigned char*>(BaseRegionObject->get_address()))
+            ->NextGeneration.store(generation);
+        old_block->NextGeneration.store(generation);
+        old_block->Notification.fetch_add(1);
+        Notifier::WakeAll(old_block->Notification);
+        if (old_block->ReadinessSubscribers.load() != 0) ReadinessChannel::Notify(old_block);
+
+        MemoryObject = std::move(memory);
+        RegionObject = std::move(region);
+        MaxSize = static_cast<unsigned int>(max_size);
+    }
+
+    /// Move to the newest generation of an opened block if it has been resized.
+    void PictureWriter::FollowGeneration()
+    {
+        if (Options.Layout != BlockOptions::Layouts::Ring) return;
+        auto generation = BlockLayout::GetBlockHeader(GetMemoryPointer())->NextGeneration.load();
+        if (generation == 0) return;
+        BaseMemoryObject = std::move(MemoryObject);
+        BaseRegionObject = std::move(RegionObject);
+        MemoryObject = std::make_unique<boost::interprocess::shared_memory_object>(
+                boost::interprocess::open_only, BlockLayout::GetGenerationName(BlockName, generation).c_str(),
+                boost::interprocess::read_write);
+        RegionObject = std::make_shared<boost::interprocess::mapped_region>(
+                *MemoryObject,
+                boost::interprocess::read_write);
+        InitializeBlock(false);
+        MaxSize = static_cast<unsigned int>(std::min<std::size_t>(
+                std::numeric_limits<unsigned int>::max(),
+                BlockLayout::GetSlotCapacity(BlockLayout::GetBlockHeader(GetMemoryPointer()))));
+    }
+
+    /// Find a ring layout slot which is neither the latest one nor held by any reader.
+    unsigned int PictureWriter::FindFreeSlot()
+    {
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        // In the queue mode, pictures are written in order, the picture with sequence number N is in slot N % count.
+        if (block->QueueReaders != 0)
+            return static_cast<unsigned int>((block->Sequence.load(std::memory_order_relaxed) + 1) % block->SlotCount);
+        auto latest_slot = block->LatestSlot.load();
+        auto first_slot = latest_slot == NoSlot ? 0 : latest_slot + 1;
+        for (unsigned int offset = 0; offset < block->SlotCount; ++offset)
+        {
+            auto slot = (first_slot + offset) % block->SlotCount;
+            if (slot == latest_slot) continue;
+            // Readers only start holding the latest slot, so a slot which is not held now will not be held
+            // before it is published by this writer.
+            if (BlockLayout::GetSlotHeader(GetMemoryPointer(), slot)->Readers.load() == 0) return slot;
+        }
+        return NoSlot;
+    }
+
+    /// Acquire a picture buffer in the shared memory block to write a picture in place.
+    cv::Mat PictureWriter::AcquireWriteBuffer(const PictureHeader &header)
+    {
+        if (!GetMemoryPointer())
+            throw std::runtime_error("Failed to acquire write buffer: shared memory has not been opened.");
+        if (Pending)
+            throw std::runtime_error("Failed to acquire write buffer: the last acquired buffer is not committed.");
+        // Headers may come from other processes or peers, so their sizes are multiplied with overflow checks.
+        std::size_t picture_size;
+        if (!HeaderCoder::GetCheckedPictureSize(header, picture_size))
+            throw std::runtime_error("Failed to acquire write buffer: the picture size overflows.");
+        // An empty buffer means that all slots are held, so an empty picture can not be acquired.
+        if (picture_size == 0)
+            throw std::runtime_error("Failed to acquire write buffer: the picture is empty.");
+
+        if (Options.Layout == BlockOptions::Layouts::Ring)
         {
-            if (GetMaxSize() < picture.elemSize())
+            auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+            auto row_stride = BlockLayout::GetRowStride(block, HeaderCoder::GetRowSize(header));
+            auto row_count = HeaderCoder::GetRowCount(header);
+            if (row_stride > std::numeric_limits<std::size_t>::max() / row_count)
+                throw std::runtime_error("Failed to acquire write buffer: the padded picture size overflows.");
+            auto buffer_size = row_stride * row_count;
+            if (GetMaxSize() < buffer_size && Options.Resizable)
+            {
+                Resize(buffer_size);
+                block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+            }
+            if (GetMaxSize() < buffer_size)
             {
                 throw std::runtime_error("Insufficient shared memory space for the picture to write: "
-                    + std::to_string(GetMaxSize()) + " bytes for "
-                    + std::to_string(picture.elemSize()) + " bytes.");
+                    + std::to_string(GetMaxSize()) + " bytes for " + std::to_string(buffer_size) + " bytes.");
             }
-            HeaderCoder::Encode(HeaderCoder::GetHeader(picture),
-                                static_cast<unsigned char *>(RegionObject->get_address()));
-            cv::Mat destination(cv::Size(picture.cols, picture.rows), picture.type(), GetPointer());
-            picture.copyTo(destination);
+            auto slot = FindFreeSlot();
+            if (slot == NoSlot)
+            {
+                block->Statistics.RefusedWrites.fetch_add(1, std::memory_order_relaxed);
+                return cv::Mat();
+            }
+            PendingTime = BlockLayout::GetTimeStamp();
+            auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), slot);
+            unsigned char encoded_header[sizeof(SlotHeader::Picture)];
+            HeaderCoder::EncodeExtended(header, encoded_header);
+            // The picture left in the slot can be updated tile by tile if it has the same header.
+            auto content_sequence = slot_header->Sequence.load(std::memory_order_relaxed);
+            PendingContent = content_sequence != 0 && content_sequence % 2 == 0 &&
+                             slot_header->Codec == PayloadCodecs::Raw &&
+                             std::memcmp(encoded_header, slot_header->Picture, sizeof(encoded_header)) == 0 ?
+                             content_sequence / 2 : 0;
+            auto sequence = block->Sequence.load(std::memory_order_relaxed) + 1;
+            // Mark the slot as being written before touching its content.
+            slot_header->Sequence.store(sequence * 2 - 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(slot_header->Picture, encoded_header, sizeof(encoded_header));
+            slot_header->RowStride = row_stride;
+            slot_header->Codec = PayloadCodecs::Raw;
+            slot_header->EncodedSize = 0;
+            slot_header->LevelCount = 0;
+            slot_header->TileColumns = 0;
+            slot_header->Metadata = FrameMetadata();
+            PendingSlot = slot;
+            Pending = true;
+            return HeaderCoder::GetPicture(header, BlockLayout::GetSlotPointer(GetMemoryPointer(), slot), row_stride);
+        }
+
+        if (GetMaxSize() < picture_size)
+        {
+            throw std::runtime_error("Insufficient shared memory space for the picture to write: "
+                + std::to_string(GetMaxSize()) + " bytes for " + std::to_string(picture_size) + " bytes.");
+        }
+        HeaderCoder::Encode(header, GetMemoryPointer());
+        Pending = true;
+        return HeaderCoder::GetPicture(header, GetPointer());
+    }
+
+    /// Publish the picture written into the acquired buffer.
+    void PictureWriter::Commit()
+    {
+        if (!Pending) throw std::runtime_error("Failed to commit: no write buffer has been acquired.");
+        Pending = false;
+        if (Options.Layout != BlockOptions::Layouts::Ring) return;
+
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), PendingSlot);
+        PictureHeader header;
+        HeaderCoder::DecodeExtended(slot_header->Picture, header);
+        if (block->PyramidLevels != 0 && slot_header->LevelCount == 0 && slot_header->Codec == PayloadCodecs::Raw)
+        {
+            WritePyramid(HeaderCoder::GetPicture(header, BlockLayout::GetSlotPointer(GetMemoryPointer(), PendingSlot),
+                                                 slot_header->RowStride));
+        }
+        auto now = BlockLayout::GetTimeStamp();
+        slot_header->Metadata.PublishTime = now;
+        auto& statistics = block->Statistics;
+        statistics.WrittenPictures.fetch_add(1, std::memory_order_relaxed);
+        statistics.WrittenBytes.fetch_add(slot_header->Codec != PayloadCodecs::Raw ? slot_header->EncodedSize :
+                                          slot_header->RowStride * HeaderCoder::GetRowCount(header),
+                                          std::memory_order_relaxed);
+        statistics.WriteTime.fetch_add(static_cast<std::uint64_t>(now - PendingTime), std::memory_order_relaxed);
+        BlockStatistics::Record(statistics.WriteLatency, now - PendingTime);
+        auto sequence = block->Sequence.load(std::memory_order_relaxed) + 1;
+        slot_header->Sequence.store(sequence * 2, std::memory_order_release);
+        block->LatestSlot.store(PendingSlot);
+        block->Sequence.store(sequence);
+        block->Notification.fetch_add(1);
+        if (block->Waiters.load() != 0) Notifier::WakeAll(block->Notification);
+        if (block->ReadinessSubscribers.load() != 0) ReadinessChannel::Notify(block);
+        PendingSlot = NoSlot;
+    }
+
+    /// Downsample the levels of the picture into the acquired slot.
+    void PictureWriter::WritePyramid(const cv::Mat &picture)
+    {
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), PendingSlot);
+        auto* payload = BlockLayout::GetSlotPointer(GetMemoryPointer(), PendingSlot);
+        slot_header->LevelCount = 0;
+        if (picture.dims != 2) return;
+        // Every level is downsampled from the previous one, which is still in the cache.
+        auto level = picture;
+        std::size_t offset = block->PyramidOffset;
+        unsigned int count = 0;
+        for (; count < block->PyramidLevels; ++count)
+        {
+            auto size = PictureDownsampler::GetHalfSize(level.size());
+            auto level_size = static_cast<std::size_t>(size.area()) * level.elemSize();
+            if (size.width == 0 || size.height == 0 ||
+                offset + level_size > block->SlotSize - block->PayloadOffset) break;
+            cv::Mat target(size, level.type(), payload + offset);
+            PictureDownsampler::Downsample(level, target);
+            slot_header->Levels[count].Offset = offset;
+            slot_header->Levels[count].Rows = static_cast<std::uint32_t>(size.height);
+            slot_header->Levels[count].Columns = static_cast<std::uint32_t>(size.width);
+            offset += BlockLayout::AlignSize(level_size, block->PayloadAlignment);
+            level = target;
+        }
+        slot_header->LevelCount = count;
+    }
+
+    /// Set the metadata of the picture in the acquired buffer.
+    void PictureWriter::SetMetadata(const FrameMetadata &metadata)
+    {
+        if (!Pending || Options.Layout != BlockOptions::Layouts::Ring)
+            throw std::runtime_error("Failed to set metadata: no ring layout write buffer has been acquired.");
+        if (metadata.UserDataSize > FrameMetadata::MaxUserDataSize)
+            throw std::runtime_error("Failed to set metadata: user data exceeds the max size.");
+        BlockLayout::GetSlotHeader(GetMemoryPointer(), PendingSlot)->Metadata = metadata;
+    }
+
+    /// Give up the acquired buffer without publishing it.
+    void PictureWriter::Cancel()
+    {
+        if (!Pending) return;
+        Pending = false;
+        if (Options.Layout != BlockOptions::Layouts::Ring) return;
+        // The slot keeps the odd sequence lock of the cancelled write, so readers and tile updates never take
+        // its half written content, and it is reused by the next write for it is not held.
+        PendingSlot = NoSlot;
+    }
+
+    /// Hold a free ring layout slot for a picture allocated in place.
+    unsigned int PictureWriter::HoldFreeSlot()
+    {
+        if (!GetMemoryPointer() || Options.Layout != BlockOptions::Layouts::Ring || Pending) return NoSlot;
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        // Slots of the queue mode are overwritten in order, they can not be held.
+        if (block->QueueReaders != 0) return NoSlot;
+        auto slot = FindFreeSlot();
+        if (slot == NoSlot) return NoSlot;
+        auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), slot);
+        slot_header->Readers.fetch_add(1);
+        // The old picture will be overwritten, so the slot stays locked like a write until it is published,
+        // and readers and tile updates never compare or walk back to its changing content.
+        slot_header->Sequence.store(HeldSlotSequence, std::memory_order_release);
+        return slot;
+    }
+
+    /// Publish a picture written in place into a held slot.
+    void PictureWriter::PublishHeldSlot(unsigned int slot, const PictureHeader &header, std::size_t row_stride,
+                                        std::int64_t hold_time, const FrameMetadata *metadata)
+    {
+        if (Pending)
+            throw std::runtime_error("Failed to publish picture: the last acquired buffer is not committed.");
+        if (metadata && metadata->UserDataSize > FrameMetadata::MaxUserDataSize)
+            throw std::runtime_error("Failed to publish picture: user data exceeds the max size.");
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), slot);
+        auto sequence = block->Sequence.load(std::memory_order_relaxed) + 1;
+        slot_header->Sequence.store(sequence * 2 - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        HeaderCoder::EncodeExtended(header, slot_header->Picture);
+        slot_header->RowStride = row_stride;
+        slot_header->Codec = PayloadCodecs::Raw;
+        slot_header->EncodedSize = 0;
+        slot_header->LevelCount = 0;
+        slot_header->TileColumns = 0;
+        slot_header->Metadata = metadata ? *metadata : FrameMetadata();
+        PendingSlot = slot;
+        PendingTime = hold_time;
+        Pending = true;
+        Commit();
+    }
+
+    /// Write a cv::Mat into shared memory block.
+    bool PictureWriter::Write(const cv::Mat &picture)
+    {
+        return WritePicture(picture, nullptr);
+    }
+
+    /// Write a cv::Mat with its metadata into shared memory block.
+    bool PictureWriter::Write(const cv::Mat &picture, const FrameMetadata &metadata)
+    {
+        if (Options.Layout != BlockOptions::Layouts::Ring)
+            throw std::runtime_error("Failed to write picture: metadata requires the ring layout.");
+        if (metadata.UserDataSize > FrameMetadata::MaxUserDataSize)
+            throw std::runtime_error("Failed to write picture: user data exceeds the max size.");
+        return WritePicture(picture, &metadata);
+    }
+
+    /// Write a cv::Mat with its optional metadata into shared memory block.
+    bool PictureWriter::WritePicture(const cv::Mat &picture, const FrameMetadata *metadata)
+    {
+        if (!GetMemoryPointer()) return false;
+        if (picture.empty())
+        {
+            // The single layout publishes an empty header like old writers did, a ring layout slot can not be empty.
+            if (Options.Layout == BlockOptions::Layouts::Ring)
+                throw std::runtime_error("Failed to write picture: the picture is empty.");
+            HeaderCoder::Encode(HeaderCoder::GetHeader(picture), GetMemoryPointer());
             return true;
         }
-        return false;
+        auto destination = AcquireWriteBuffer(HeaderCoder::GetHeader(picture));
+        if (destination.empty()) return false;
+        try
+        {
+            if (metadata) SetMetadata(*metadata);
+            if (Codec != PayloadCodecs::Raw)
+            {
+                // Encoded bytes are only kept if they are fewer than the raw bytes.
+                auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), PendingSlot);
+                auto encoded_size = PayloadCodec::Encode(
+                        picture, BlockLayout::GetSlotPointer(GetMemoryPointer(), PendingSlot),
+                        std::min(BlockLayout::GetSlotCapacity(BlockLayout::GetBlockHeader(GetMemoryPointer())),
+                                 picture.total() * picture.elemSize()));
+                if (encoded_size > 0)
+                {
+                    slot_header->Codec = Codec;
+                    slot_header->EncodedSize = encoded_size;
+                    // Levels are kept raw, and are downsampled from the picture for the slot holds encoded bytes.
+                    WritePyramid(picture);
+                    Commit();
+                    return true;
+                }
+            }
+            if (Options.Layout == BlockOptions::Layouts::Ring && Options.TileSize != 0 && picture.dims == 2)
+                WriteTiles(picture, destination);
+            else
+                PictureCopier::Copy(picture, destination);
+        }catch(...)
+        {
+            Cancel();
+            throw;
+        }
+        Commit();
+        return true;
+    }
+
+    /// Check whether a tile of two pictures with the same size and type has the same bytes.
+    static bool IsTileEqual(const cv::Mat& first, const cv::Mat& second, const cv::Rect& tile)
+    {
+        auto offset = static_cast<std::size_t>(tile.x) * first.elemSize();
+        auto size = static_cast<std::size_t>(tile.width) * first.elemSize();
+        for (int row = tile.y; row < tile.y + tile.height; ++row)
+        {
+            if (std::memcmp(first.ptr(row) + offset, second.ptr(row) + offset, size) != 0) return false;
+        }
+        return true;
+    }
+
+    /// Copy a tile between pictures with the same size and type.
+    static void CopyTile(const cv::Mat& source, cv::Mat& destination, const cv::Rect& tile)
+    {
+        auto offset = static_cast<std::size_t>(tile.x) * source.elemSize();
+        auto size = static_cast<std::size_t>(tile.width) * source.elemSize();
+        for (int row = tile.y; row < tile.y + tile.height; ++row)
+        {
+            std::memcpy(destination.ptr(row) + offset, source.ptr(row) + offset, size);
+        }
+    }
+
+    /// Copy the changed tiles of a picture into the acquired slot and publish which tiles are changed.
+    void PictureWriter::WriteTiles(const cv::Mat &picture, cv::Mat &destination)
+    {
+        auto* block = BlockLayout::GetBlockHeader(GetMemoryPointer());
+        auto* slot_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), PendingSlot);
+        auto tile_size = static_cast<int>(block->TileSize);
+        auto columns = (picture.cols + tile_size - 1) / tile_size;
+        auto rows = (picture.rows + tile_size - 1) / tile_size;
+        if (static_cast<std::size_t>(columns) * rows > MaxDirtyTiles)
+        {
+            PictureCopier::Copy(picture, destination);
+            return;
+        }
+
+        // Changed tiles are the ones which differ from the latest picture if it has the same header.
+        cv::Mat previous;
+        std::uint64_t previous_sequence = 0;
+        auto latest_slot = block->LatestSlot.load();
+        if (latest_slot != NoSlot)
+        {
+            auto* latest_header = BlockLayout::GetSlotHeader(GetMemoryPointer(), latest_slot);
+            if (latest_header->Codec == PayloadCodecs::Raw &&
+                std::memcmp(latest_header->Picture, slot_header->Picture, sizeof(SlotHeader::Picture)) == 0)
+            {
+                previous = HeaderCoder::GetPicture(HeaderCoder::GetHeader(picture),
+                                                   BlockLayout::GetSlotPointer(GetMemoryPointer(), latest_slot),
+                                                   latest_header->RowStride);
+                previous_sequence = latest_header->Sequence.load(std::memory_order_relaxed) / 2;
+            }
+        }
+
+        std::vector<unsigned char> changes(static_cast<std::size_t>(columns) * rows, 1);
+        auto write_tile_row = [&](std::size_t tile_row){
+            for (int tile_column = 0; tile_column < columns; ++tile_column)
+            {
+                cv::Rect tile(tile_column * tile_size, static_cast<int>(tile_row) * tile_size,
+                              std::min(tile_size, picture.cols - tile_column * tile_size),
+                              std::min(tile_size, picture.rows - static_cast<int>(tile_row) * tile_size));
+                bool changed = previous.empty() || !IsTileEqual(picture, previous, tile);
+                changes[tile_row * columns + tile_column] = changed;
+                // An unchanged tile is only copied if the picture left in the slot differs from it.
+                if (changed || PendingContent == 0 || !IsTileEqual(picture, destination, tile))
+                    CopyTile(picture, destination, tile);
+            }
+        };
+        // Small pictures are compared and copied inline, as waking the workers costs more than the work.
+        auto& engine = CopyEngine::GetDefault();
+        if (picture.total() * picture.elemSize() >= engine.GetParallelThreshold())
+        {
+            engine.Run(static_cast<std::size_t>(rows), write_tile_row);
+        }
+        else
+        {
+            for (std::size_t tile_row = 0; tile_row < static_cast<std::size_t>(rows); ++tile_row)
+            {
+                write_tile_row(tile_row);
+            }
+        }
+
+        std::fill(std::begin(slot_header->DirtyTiles), std::end(slot_header->DirtyTiles), 0);
+        for (std::size_t index = 0; index < changes.size(); ++index)
+        {
+            if (changes[index]) slot_header->DirtyTiles[index / 64] |= std::uint64_t(1) << (index % 64);
+        }
+        slot_header->TileColumns = static_cast<std::uint32_t>(columns);
+        slot_header->TileRows = static_cast<std::uint32_t>(rows);
+        slot_header->TileBase = previous_sequence;
+    }
+
+    /// Set the codec used by Write(const cv::Mat&).
+    void PictureWriter::SetCodec(PayloadCodecs codec)
+    {
+        if (codec != PayloadCodecs::Raw && Options.Layout != BlockOptions::Layouts::Ring)
+            throw std::runtime_error("Failed to set codec: codecs require the ring layout.");
+        Codec = codec;
+    }
+
+    /// Write a batch of pictures with the same size and type into shared memory block as one picture.
+    bool PictureWriter::Write(const std::vector<cv::Mat> &batch)
+    {
+        if (batch.empty()) throw std::runtime_error("Failed to write batch: the batch is empty.");
+        auto picture_header = HeaderCoder::GetHeader(batch.front());
+        auto picture_shape = HeaderCoder::GetShape(picture_header);
+        if (picture_shape.size() + 1 > PictureHeader::MaxDimensions)
+        {
+            throw std::runtime_error("Failed to write batch: pictures have too many dimensions.");
+        }
+        for (const auto& picture : batch)
+        {
+            if (picture.type() != batch.front().type() ||
+                HeaderCoder::GetShape(HeaderCoder::GetHeader(picture)) != picture_shape)
+                throw std::runtime_error("Failed to write batch: pictures must have the same size and type.");
+        }
+
+        // The batch is one more outermost dimension in front of the dimensions of its pictures.
+        auto header = picture_header;
+        header.Dimensions = static_cast<unsigned int>(picture_shape.size() + 1);
+        header.Shape.fill(0);
+        header.Shape[0] = static_cast<unsigned int>(batch.size());
+        for (std::size_t dimension = 0; dimension < picture_shape.size(); ++dimension)
+        {
+            header.Shape[dimension + 1] = static_cast<unsigned int>(picture_shape[dimension]);
+        }
+        header.Width = 0;
+        header.Height = 0;
+
+        if (!GetMemoryPointer()) return false;
+        auto destination = AcquireWriteBuffer(header);
+        if (destination.empty()) return false;
+        try
+        {
+            for (std::size_t index = 0; index < batch.size(); ++index)
+            {
+                cv::Mat element(static_cast<int>(picture_shape.size()), picture_shape.data(), destination.type(),
+                                destination.data + index * destination.step[0], &destination.step[1]);
+                PictureCopier::Copy(batch[index], element);
+            }
+        }catch(...)
+        {
+            Cancel();
+            throw;
+        }
+        Commit();
+        return true;
     }
 
     /// Set header data of the memory owned by this writer.
     void PictureWriter::SetHeader(const PictureHeader &header)
     {
         if (!RegionObject) throw std::runtime_error("Failed to set header: shared memory has not been opened.");
-        HeaderCoder::Encode(header, static_cast<unsigned char *>(RegionObject->get_address()));
+        // A published slot is read under its sequence lock, rewriting its header in place would tear it.
+        if (Options.Layout == BlockOptions::Layouts::Ring)
+        {
+            throw std::runtime_error("Failed to set header: published ring layout slots can not be changed, "
+                                     "use AcquireWriteBuffer() and Commit() instead.");
+        }
+        HeaderCoder::Encode(header, GetMemoryPointer());
     }
 }
\ No newline at end of file
@@ -2,11 +2,15 @@
 
 #include <string>
 #include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/file_mapping.hpp>
 #include <boost/interprocess/mapped_region.hpp>
 #include <memory>
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 #include "HeaderCoder.hpp"
+#include "BlockLayout.hpp"
+#include "BlockMapping.hpp"
 
 namespace Gaia::SharedPicture
 {
@@ -14,20 +18,117 @@ namespace Gaia::SharedPicture
      * @brief Picture writer provides function to write a picture into a shared memory block.
      * @details
      *  It also provides basic shared memory management operations.
+     *  In the ring layout, pictures are written into a slot which is neither the latest one
+     *  nor held by any reader, and then published atomically, so readers never see a torn picture.
      */
     class PictureWriter
     {
     private:
         /// The max capacity of the shared memory picture part.
-        const unsigned int MaxSize;
+        unsigned int MaxSize;
         /// Whether this writer owned the memory or not.
         const bool OwnedMemory;
+        /// Layout options of the memory block.
+        BlockOptions Options;
+        /// Mapping options of the memory block.
+        MappingOptions Mapping;
 
     protected:
         /// Shared memory management object.
         std::unique_ptr<boost::interprocess::shared_memory_object> MemoryObject;
+        /// Huge page file management object, used instead of the shared memory object on hugetlbfs.
+        std::unique_ptr<boost::interprocess::file_mapping> FileObject;
+        /// Base name of the shared memory block.
+        std::string BlockName;
+        /// Shared memory management object of the block of generation 0, only kept after the block is resized.
+        std::unique_ptr<boost::interprocess::shared_memory_object> BaseMemoryObject;
+        /// Shared memory accessor object of the block of generation 0, only kept after the block is resized.
+        std::shared_ptr<boost::interprocess::mapped_region> BaseRegionObject;
         /// Shared memory accessor object.
-        std::unique_ptr<boost::interprocess::mapped_region> RegionObject;
+        std::shared_ptr<boost::interprocess::mapped_region> RegionObject;
+        /// Offset of the memory block of this writer in the mapped region.
+        std::size_t RegionOffset {0};
+        /// Bytes of the memory block of this writer, 0 means the rest of the mapped region.
+        std::size_t RegionSize {0};
+        /// Index of the ring layout slot acquired to write in place.
+        unsigned int PendingSlot {NoSlot};
+        /// Whether a write buffer is acquired and not committed yet.
+        bool Pending {false};
+        /// Sequence number of the picture left in the acquired slot if it has the header of the acquired picture.
+        std::uint64_t PendingContent {0};
+        /// Time stamp when the ring layout slot is acquired, in nanoseconds of the steady clock.
+        std::int64_t PendingTime {0};
+        /// Codec used by Write(const cv::Mat&) in the ring layout.
+        PayloadCodecs Codec {PayloadCodecs::Raw};
+
+        /**
+         * @brief Find a ring layout slot which can be overwritten.
+         * @return Index of the slot, or NoSlot if all slots are held by readers.
+         * @details In the queue mode, it is the slot of the oldest picture, which is never held.
+         */
+        unsigned int FindFreeSlot();
+
+        /// Check the layout options of a memory block to create.
+        void CheckOptions() const;
+        /**
+         * @brief Move to a bigger block of the next generation, which can hold pictures of the given size.
+         * @throws runtime_error If the block is not a resizable ring layout block in POSIX shared memory.
+         * @details Readers move to the new block on their next read, retired blocks except the base one are removed.
+         */
+        void Resize(std::size_t required_size);
+        /// Move to the newest generation of an opened block if it has been resized.
+        void FollowGeneration();
+        /// Prepare the mapped memory block, then initialize it or read its layout options.
+        void InitializeBlock(bool create);
+        /**
+         * @brief Downsample the levels of a picture into the acquired slot, up to the pyramid levels of the block.
+         * @details Pictures which are not 2-dimensional have no levels.
+         */
+        void WritePyramid(const cv::Mat& picture);
+        /**
+         * @brief Copy the tiles of a picture which differ from the picture left in the acquired slot,
+         *        and publish which tiles differ from the latest picture.
+         * @details Pictures with more than MaxDirtyTiles tiles are copied completely without publishing tiles.
+         */
+        void WriteTiles(const cv::Mat& picture, cv::Mat& destination);
+        /// Write a picture with its metadata if it is not null, see Write(const cv::Mat&).
+        bool WritePicture(const cv::Mat& picture, const FrameMetadata* metadata);
+
+        /**
+         * @brief Hold a free ring layout slot for a picture allocated in place by SharedMatAllocator.
+         * @return Index of the held slot, or NoSlot if all slots are held, a buffer is acquired,
+         *         or the block is in the queue mode.
+         * @details The slot is held like readers hold slots, so it is not overwritten until its reader counter
+         *          is decreased, and its old picture is discarded: its sequence lock is HeldSlotSequence
+         *          until the picture is published.
+         */
+        unsigned int HoldFreeSlot();
+        /**
+         * @brief Publish a picture written in place into a slot held by HoldFreeSlot(), which stays held.
+         * @param slot Index of the held slot.
+         * @param header Header of the picture.
+         * @param row_stride Bytes between the beginnings of two adjacent rows of the picture.
+         * @param hold_time Time stamp when the slot is held, in nanoseconds of the steady clock.
+         * @param metadata Metadata of the picture, or null for empty metadata.
+         * @throws runtime_error If a buffer is acquired, or the user data is too big.
+         */
+        void PublishHeldSlot(unsigned int slot, const PictureHeader& header, std::size_t row_stride,
+                             std::int64_t hold_time, const FrameMetadata* metadata);
+
+        friend class SharedPictureArena;
+        friend class SharedMatAllocator;
+
+        /**
+         * @brief Construct a writer on a memory block in a mapped region shared with other pictures.
+         * @param region Mapped region holding the memory block.
+         * @param offset Offset of the memory block in the region.
+         * @param size Bytes of the memory block.
+         * @param max_picture_size Picture part size of the memory block.
+         * @param create Whether to initialize the memory block, otherwise its layout options are read from it.
+         * @param options Layout options of the memory block to initialize.
+         */
+        PictureWriter(std::shared_ptr<boost::interprocess::mapped_region> region, std::size_t offset,
+                      std::size_t size, unsigned int max_picture_size, bool create, const BlockOptions& options);
 
     public:
         /// Release the memory if it owns the memory.
@@ -37,29 +138,84 @@ namespace Gaia::SharedPicture
          * @brief Create or open the shared memory block and construct a writer on it.
          * @param shared_block_name Name of the shared memory block.
          * @param max_picture_size Picture part size of the memory block, total size is max_size + 10.
-         * @param create If false, then only try to open the existing memory block.
+         *                         In the ring layout, it is the picture part size of every slot.
+         * @param create If false, then only try to open the existing memory block,
+         *               and the layout options are read from the block.
+         * @param options Layout options of the memory block to create.
+         * @param mapping Mapping options of the memory block, such as huge pages, prefaulting and NUMA binding.
          */
-        PictureWriter(const std::string& shared_block_name, unsigned int max_picture_size, bool create = true);
+        PictureWriter(const std::string& shared_block_name, unsigned int max_picture_size, bool create = true,
+                      const BlockOptions& options = BlockOptions(), const MappingOptions& mapping = MappingOptions());
 
         /// Move constructor.
         PictureWriter(PictureWriter&& target) noexcept;
         /// Copy constructor.
         PictureWriter(const PictureWriter& target);
 
+        /// Get the bytes of a memory block holding pictures of the given size in the given layout.
+        static std::size_t GetBlockSize(unsigned int max_picture_size, const BlockOptions& options);
+
         /// Get the max size of the space for picture in shared memory block.
         [[nodiscard]] inline const unsigned int& GetMaxSize() const noexcept
         {
             return MaxSize;
         }
-        /// Get the address of the picture buffer memory, after the header part.
-        [[nodiscard]] inline unsigned char* GetPointer() const
+        /// Get the layout options of the memory block.
+        [[nodiscard]] inline const BlockOptions& GetOptions() const noexcept
+        {
+            return Options;
+        }
+        /// Get the mapping options of the memory block.
+        [[nodiscard]] inline const MappingOptions& GetMappingOptions() const noexcept
+        {
+            return Mapping;
+        }
+        /// Get the codec used by Write(const cv::Mat&).
+        [[nodiscard]] inline PayloadCodecs GetCodec() const noexcept
+        {
+            return Codec;
+        }
+        /**
+         * @brief Set the codec used by Write(const cv::Mat&).
+         * @throws runtime_error If a codec other than raw is set for the single layout.
+         * @details
+         *  A picture is stored raw if its encoded bytes are not fewer than its raw bytes.
+         *  Encoded pictures can only be read by PictureReader::ReadCopy() and PictureReader::TryRead().
+         */
+        void SetCodec(PayloadCodecs codec);
+
+        /// Get the address of the shared memory.
+        [[nodiscard]] inline unsigned char* GetMemoryPointer() const
         {
             if (RegionObject && RegionObject->get_address())
-                return static_cast<unsigned char*>(RegionObject->get_address()) + 10;
+                return static_cast<unsigned char*>(RegionObject->get_address()) + RegionOffset;
             return nullptr;
         }
+        /// Get the size of the shared memory.
+        [[nodiscard]] inline std::size_t GetMemorySize() const
+        {
+            if (!RegionObject) return 0;
+            return RegionSize != 0 ? RegionSize : RegionObject->get_size() - RegionOffset;
+        }
+        /**
+         * @brief Get the address of the picture buffer memory, after the header part.
+         * @details In the ring layout, it is the picture buffer of the latest slot, aligned to the payload alignment.
+         */
+        [[nodiscard]] inline unsigned char* GetPointer() const
+        {
+            auto* address = GetMemoryPointer();
+            if (!address) return nullptr;
+            if (Options.Layout == BlockOptions::Layouts::Single) return address + 10;
+            auto slot = BlockLayout::GetBlockHeader(address)->LatestSlot.load();
+            if (slot == NoSlot) return nullptr;
+            return BlockLayout::GetSlotPointer(address, slot);
+        }
 
-        /// Manually set the header data of the memory block owned by this writer.
+        /**
+         * @brief Manually set the header data of the memory block owned by this writer.
+         * @throws runtime_error If the block is in the ring layout, where a header is published with its picture
+         *                       by AcquireWriteBuffer() and Commit().
+         */
         void SetHeader(const PictureHeader& header);
         /// Manually set the header data of the memory block owned by this writer according to the given picture.
         void SetHeader(const cv::Mat& picture)
@@ -71,12 +227,74 @@ namespace Gaia::SharedPicture
          * @brief Write a picture into the connected shared memory block.
          * @param picture Picture to write down.
          * @retval true Successfully written.
-         * @retval false Failed to write.
-         * @throws runtime_error If size of picture is bigger than max size.
+         * @retval false Failed to write, or all slots of the ring layout are held by readers.
+         * @throws runtime_error If size of picture is bigger than max size, or an empty picture is written
+         *                       into the ring layout.
          * @detials This function will auto set the header data generated from
+         *          In the ring layout, the picture is encoded by the codec set by SetCodec().
+         *          Downsampled levels of the picture are published with it if the block has pyramid levels.
+         *          If the block has tiles, only the tiles which differ from the picture left in the slot are copied.
          */
         bool Write(const cv::Mat& picture);
 
+        /**
+         * @brief Write a picture with its metadata, published atomically together.
+         * @param picture Picture to write down.
+         * @param metadata Metadata of the picture, its publication time stamp is set by this writer.
+         * @retval true Successfully written.
+         * @retval false Failed to write, or all slots of the ring layout are held by readers.
+         * @throws runtime_error If the block is not in the ring layout, or the picture or the user data is too big.
+         */
+        bool Write(const cv::Mat& picture, const FrameMetadata& metadata);
+
+        /**
+         * @brief Write a batch of pictures as one picture with one more outermost dimension, published at once.
+         * @param batch Pictures with the same size and type, such as N pictures of H x W with C channels
+         *              which are written as a picture of N x H x W with C channels.
+         * @retval true Successfully written.
+         * @retval false Failed to write, or all slots of the ring layout are held by readers.
+         * @throws runtime_error If the batch is empty, pictures differ in size or type, or the batch is too big.
+         * @details Only the ring layout can describe more than 2 dimensions.
+         */
+        bool Write(const std::vector<cv::Mat>& batch);
+
+        /**
+         * @brief Acquire a picture buffer in the shared memory block, to produce a picture in place without copying.
+         * @param header Header of the picture to produce.
+         * @return Picture mapped onto the shared memory, or an empty picture if all ring layout slots are held.
+         * @throws runtime_error If size of picture is bigger than max size and the block is not resizable,
+         *                       the picture is empty or its size overflows, or the last buffer is not committed.
+         * @details
+         *  Write the picture through the returned cv::Mat, such as the destination of cv::resize,
+         *  without reallocating it, then call Commit() to publish it.
+         *  In the single layout, readers may see the picture before it is committed.
+         */
+        cv::Mat AcquireWriteBuffer(const PictureHeader& header);
+        /// Acquire a picture buffer with the header of the given picture, see AcquireWriteBuffer(const PictureHeader&).
+        cv::Mat AcquireWriteBuffer(const cv::Mat& picture)
+        {
+            return AcquireWriteBuffer(HeaderCoder::GetHeader(picture));
+        }
+
+        /**
+         * @brief Publish the picture written into the acquired buffer.
+         * @throws runtime_error If no buffer is acquired.
+         * @details
+         *  The acquired cv::Mat must not be written after this call.
+         *  Pyramid levels of the block are downsampled from the written picture before it is published.
+         */
+        void Commit();
+
+        /**
+         * @brief Set the metadata of the picture in the acquired buffer, published by Commit() with the picture.
+         * @throws runtime_error If no ring layout buffer is acquired, or the user data is too big.
+         * @details The metadata of an acquired buffer is empty until it is set, except its publication time stamp.
+         */
+        void SetMetadata(const FrameMetadata& metadata);
+
+        /// Give up the acquired buffer without publishing it.
+        void Cancel();
+
         /// Release the memory block if it owns the memory.
         void Release();
     };
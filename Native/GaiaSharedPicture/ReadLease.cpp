@@ -0,0 +1,68 @@
+#include "ReadLease.hpp"
+
+namespace Gaia::SharedPicture
+{
+    /// Take over a slot which has been held by increasing its reader counter.
+    ReadLease::ReadLease(std::atomic<std::uint32_t> *readers, unsigned int slot, std::uint64_t sequence):
+        Readers(readers), Sequence(sequence), Slot(slot)
+    {}
+
+    /// Release the held slot.
+    ReadLease::~ReadLease()
+    {
+        Release();
+    }
+
+    /// Move constructor.
+    ReadLease::ReadLease(ReadLease &&target) noexcept:
+        Readers(target.Readers), Picture(std::move(target.Picture)), Sequence(target.Sequence), Slot(target.Slot),
+        Mapping(std::move(target.Mapping)), Metadata(target.Metadata), Header(target.Header), Codec(target.Codec),
+        Payload(target.Payload), PayloadSize(target.PayloadSize)
+    {
+        target.Readers = nullptr;
+        target.Metadata = nullptr;
+        target.Slot = NoSlot;
+        target.Payload = nullptr;
+        target.PayloadSize = 0;
+    }
+
+    /// Move assignment, the slot held by this lease is released.
+    ReadLease& ReadLease::operator=(ReadLease &&target) noexcept
+    {
+        if (this != &target)
+        {
+            Release();
+            Readers = target.Readers;
+            Picture = std::move(target.Picture);
+            Sequence = target.Sequence;
+            Slot = target.Slot;
+            Mapping = std::move(target.Mapping);
+            Metadata = target.Metadata;
+            Header = target.Header;
+            Codec = target.Codec;
+            Payload = target.Payload;
+            PayloadSize = target.PayloadSize;
+            target.Readers = nullptr;
+            target.Metadata = nullptr;
+            target.Slot = NoSlot;
+            target.Payload = nullptr;
+            target.PayloadSize = 0;
+        }
+        return *this;
+    }
+
+    /// Release the held slot, so the writer can overwrite it again.
+    void ReadLease::Release()
+    {
+        if (!Readers) return;
+        // The picture must not alias the slot after it is released.
+        Picture.release();
+        Readers->fetch_sub(1);
+        Readers = nullptr;
+        Slot = NoSlot;
+        Mapping.reset();
+        Metadata = nullptr;
+        Payload = nullptr;
+        PayloadSize = 0;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <opencv2/opencv.hpp>
+
+#include "BlockLayout.hpp"
+
+namespace Gaia::SharedPicture
+{
+    class PictureReader;
+
+    /**
+     * @brief Lease of a ring layout slot, the writer never overwrites the slot while the lease is held.
+     * @details
+     *  The picture of a lease aliases the shared memory without copying,
+     *  and it is valid until the lease is released or destroyed.
+     *  A lease must not outlive the reader which creates it.
+     */
+    class ReadLease
+    {
+        friend class PictureReader;
+
+    private:
+        /// Reader counter of the held slot.
+        std::atomic<std::uint32_t>* Readers {nullptr};
+        /// Picture in the held slot.
+        cv::Mat Picture;
+        /// Sequence number of the picture.
+        std::uint64_t Sequence {0};
+        /// Index of the held slot.
+        unsigned int Slot {NoSlot};
+        /// Mapping of the held slot, kept alive after the reader has moved to a newer generation of the block.
+        std::shared_ptr<const void> Mapping;
+        /// Metadata of the picture in the held slot.
+        const FrameMetadata* Metadata {nullptr};
+        /// Header of the picture in the held slot.
+        PictureHeader Header;
+        /// Codec of the picture bytes in the held slot.
+        PayloadCodecs Codec {PayloadCodecs::Raw};
+        /// Encoded bytes in the held slot, null if the picture is raw.
+        const unsigned char* Payload {nullptr};
+        /// Count of the encoded bytes in the held slot.
+        std::size_t PayloadSize {0};
+
+        /// Take over a slot which has been held by increasing its reader counter.
+        ReadLease(std::atomic<std::uint32_t>* readers, unsigned int slot, std::uint64_t sequence);
+
+    public:
+        /// Construct an empty lease which holds nothing.
+        ReadLease() = default;
+        /// Release the held slot.
+        ~ReadLease();
+
+        /// Move constructor.
+        ReadLease(ReadLease&& target) noexcept;
+        /// Move assignment, the slot held by this lease is released.
+        ReadLease& operator=(ReadLease&& target) noexcept;
+        ReadLease(const ReadLease&) = delete;
+        ReadLease& operator=(const ReadLease&) = delete;
+
+        /// Check whether this lease holds a slot or not.
+        [[nodiscard]] inline bool IsValid() const noexcept
+        {
+            return Readers != nullptr;
+        }
+        /// Check whether this lease holds a slot or not.
+        explicit operator bool() const noexcept
+        {
+            return IsValid();
+        }
+
+        /// Get the picture in the held slot, which aliases the shared memory.
+        [[nodiscard]] inline const cv::Mat& GetPicture() const noexcept
+        {
+            return Picture;
+        }
+        /// Get the sequence number of the picture.
+        [[nodiscard]] inline std::uint64_t GetSequence() const noexcept
+        {
+            return Sequence;
+        }
+        /// Get the metadata of the picture in the held slot, null if this lease holds nothing.
+        [[nodiscard]] inline const FrameMetadata* GetMetadata() const noexcept
+        {
+            return Metadata;
+        }
+        /// Get the index of the held slot.
+        [[nodiscard]] inline unsigned int GetSlot() const noexcept
+        {
+            return Slot;
+        }
+        /// Get the header of the picture in the held slot.
+        [[nodiscard]] inline const PictureHeader& GetHeader() const noexcept
+        {
+            return Header;
+        }
+        /// Get the codec of the picture bytes in the held slot.
+        [[nodiscard]] inline PayloadCodecs GetCodec() const noexcept
+        {
+            return Codec;
+        }
+        /// Get the encoded bytes in the held slot, null if the picture is raw, see PictureReader::LeaseEncoded().
+        [[nodiscard]] inline const unsigned char* GetPayload() const noexcept
+        {
+            return Payload;
+        }
+        /// Get the count of the encoded bytes in the held slot, 0 if the picture is raw.
+        [[nodiscard]] inline std::size_t GetPayloadSize() const noexcept
+        {
+            return PayloadSize;
+        }
+
+        /// Release the held slot, so the writer can overwrite it again.
+        void Release();
+    };
+}
\ No newline at end of file
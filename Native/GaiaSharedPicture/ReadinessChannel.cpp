@@ -0,0 +1,137 @@
+#include "ReadinessChannel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstddef>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace Gaia::SharedPicture
+{
+    #ifdef __linux__
+    /// Get the abstract Unix address of the channel with the given identifier.
+    static socklen_t GetChannelAddress(std::uint64_t identifier, sockaddr_un& address)
+    {
+        address = sockaddr_un();
+        address.sun_family = AF_UNIX;
+        // Abstract addresses begin with a null byte, they vanish with their sockets and need no cleanup.
+        auto length = std::snprintf(address.sun_path + 1, sizeof(address.sun_path) - 1,
+                                    "gaia_shared_picture/%016llx", static_cast<unsigned long long>(identifier));
+        return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + length);
+    }
+
+    /// Get the socket shared by all writers of this process to send notifications.
+    static int GetSenderDescriptor()
+    {
+        static const int descriptor = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        return descriptor;
+    }
+    #endif
+
+    /// Create a channel with a new identifier.
+    ReadinessChannel::ReadinessChannel()
+    {
+        #ifdef __linux__
+        static std::atomic<std::uint32_t> next_index {1};
+        Identifier = static_cast<std::uint64_t>(::getpid()) << 32 | next_index.fetch_add(1);
+        Descriptor = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (Descriptor < 0)
+        {
+            throw std::runtime_error("Failed to create readiness channel, failed to create the socket.");
+        }
+        sockaddr_un address;
+        auto length = GetChannelAddress(Identifier, address);
+        if (::bind(Descriptor, reinterpret_cast<const sockaddr*>(&address), length) != 0)
+        {
+            ::close(Descriptor);
+            throw std::runtime_error("Failed to create readiness channel, failed to bind the socket.");
+        }
+        #else
+        throw std::runtime_error("Failed to create readiness channel, it is only supported on Linux.");
+        #endif
+    }
+
+    /// Close the socket.
+    ReadinessChannel::~ReadinessChannel()
+    {
+        #ifdef __linux__
+        if (Descriptor >= 0) ::close(Descriptor);
+        #endif
+    }
+
+    /// Discard all pending notifications.
+    void ReadinessChannel::Drain()
+    {
+        #ifdef __linux__
+        char buffer[64];
+        while (::recv(Descriptor, buffer, sizeof(buffer), MSG_DONTWAIT) >= 0)
+        {}
+        #endif
+    }
+
+    /// Subscribe this channel to the block.
+    unsigned int ReadinessChannel::Subscribe(BlockHeader *block)
+    {
+        for (unsigned int index = 0; index < MaxReadinessSubscribers; ++index)
+        {
+            std::uint64_t expected = 0;
+            if (block->ReadinessChannels[index].compare_exchange_strong(expected, Identifier))
+            {
+                // Entries are taken from the lowest free one, so the scanned range stays as small as the peak
+                // count of subscribers. It is extended before the caller checks for pictures, so a picture
+                // published before the extension is seen by that check instead.
+                auto entries = block->ReadinessEntries.load();
+                while (entries <= index && !block->ReadinessEntries.compare_exchange_weak(entries, index + 1))
+                {}
+                block->ReadinessSubscribers.fetch_add(1);
+                return index;
+            }
+        }
+        return NoSlot;
+    }
+
+    /// Cancel the subscription of this channel in the given entry of the block.
+    void ReadinessChannel::Unsubscribe(BlockHeader *block, unsigned int index)
+    {
+        auto expected = Identifier;
+        // The writer may have canceled the subscription already, if it has failed to notify this channel.
+        if (block->ReadinessChannels[index].compare_exchange_strong(expected, 0))
+            block->ReadinessSubscribers.fetch_sub(1);
+    }
+
+    /// Notify all channels subscribed to the block.
+    void ReadinessChannel::Notify(BlockHeader *block)
+    {
+        #ifdef __linux__
+        auto sender = GetSenderDescriptor();
+        if (sender < 0) return;
+        const char signal = 1;
+        auto entries = std::min(block->ReadinessEntries.load(), MaxReadinessSubscribers);
+        for (unsigned int index = 0; index < entries; ++index)
+        {
+            auto& entry = block->ReadinessChannels[index];
+            auto identifier = entry.load(std::memory_order_relaxed);
+            if (identifier == 0) continue;
+            sockaddr_un address;
+            auto length = GetChannelAddress(identifier, address);
+            if (::sendto(sender, &signal, 1, MSG_DONTWAIT | MSG_NOSIGNAL,
+                         reinterpret_cast<const sockaddr*>(&address), length) < 0 && errno == ECONNREFUSED)
+            {
+                // Nobody is bound to the address, the reader has exited without canceling its subscription.
+                if (entry.compare_exchange_strong(identifier, 0))
+                    block->ReadinessSubscribers.fetch_sub(1);
+            }
+        }
+        #else
+        (void)block;
+        #endif
+    }
+}
\ No newline at end of file
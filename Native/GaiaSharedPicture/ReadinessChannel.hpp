@@ -0,0 +1,56 @@
+#pragma once
+
+#include "BlockLayout.hpp"
+
+#include <cstdint>
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Readiness channel of a reader, a pollable descriptor which becomes readable when pictures are published.
+     * @details
+     *  On Linux it is a non-blocking datagram socket bound to an abstract Unix address derived from its identifier.
+     *  Readers subscribe the identifier in the header of a ring layout block, and the writer sends a byte to every
+     *  subscriber after publishing, so event loops can wait on many blocks with epoll, poll or asio.
+     *  Bytes sent to a reader whose socket buffer is full are dropped, for its descriptor is readable anyway.
+     */
+    class ReadinessChannel
+    {
+        /// Descriptor of the socket.
+        int Descriptor {-1};
+        /// Identifier of this channel, unique among living channels.
+        std::uint64_t Identifier {0};
+
+    public:
+        /**
+         * @brief Create a channel with a new identifier.
+         * @throws runtime_error If the socket can not be created, or readiness channels are not supported.
+         */
+        ReadinessChannel();
+        ReadinessChannel(const ReadinessChannel&) = delete;
+        ReadinessChannel& operator=(const ReadinessChannel&) = delete;
+        /// Close the socket.
+        ~ReadinessChannel();
+
+        /// Get the descriptor, which is readable when pictures are published after the last Drain().
+        [[nodiscard]] int GetDescriptor() const
+        {
+            return Descriptor;
+        }
+
+        /// Discard all pending notifications.
+        void Drain();
+
+        /**
+         * @brief Subscribe this channel to the block.
+         * @return Index of the subscription entry, or NoSlot if all entries are taken.
+         */
+        unsigned int Subscribe(BlockHeader* block);
+        /// Cancel the subscription of this channel in the given entry of the block.
+        void Unsubscribe(BlockHeader* block, unsigned int index);
+
+        /// Notify all channels subscribed to the block, and cancel the subscriptions of closed channels.
+        /// Only the entries below the count of entries ever taken are scanned.
+        static void Notify(BlockHeader* block);
+    };
+}
\ No newline at end of file
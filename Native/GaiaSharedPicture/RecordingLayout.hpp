@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "BlockLayout.hpp"
+#include "HeaderCoder.hpp"
+
+namespace Gaia::SharedPicture
+{
+    /// Magic number at the beginning of a recording file, "GSPR" in little endian.
+    constexpr std::uint32_t RecordingMagic = 0x52505347;
+    /// Version of the recording file layout.
+    constexpr std::uint32_t RecordingVersion = 1;
+    /// Alignment of every record and of the picture bytes in it.
+    constexpr std::size_t RecordAlignment = 64;
+
+    /**
+     * @brief Header at the beginning of a recording file.
+     * @details
+     *  Records follow the header back to back, and the index of their offsets follows the last record
+     *  once the recording is closed; a recording which is not closed is indexed by walking its records.
+     */
+    struct alignas(RecordAlignment) RecordingHeader
+    {
+        /// Magic number, must be RecordingMagic.
+        std::uint32_t Magic {RecordingMagic};
+        /// Version of the layout.
+        std::uint32_t Version {RecordingVersion};
+        /// Count of records, only valid if the recording is closed.
+        std::uint64_t RecordCount {0};
+        /// Offset of the index from the beginning of the file, 0 if the recording is not closed.
+        std::uint64_t IndexOffset {0};
+        /// Offset of the end of the last record from the beginning of the file.
+        std::uint64_t DataEnd {0};
+    };
+
+    /// Header of a recorded picture, followed by its picture bytes with continuous rows.
+    struct alignas(RecordAlignment) RecordHeader
+    {
+        /// Bytes of this record, including this header and the padding, 0 ends the records.
+        std::uint64_t Size {0};
+        /// Sequence number of the picture in the recorded block.
+        std::uint64_t Sequence {0};
+        /// Time stamp in nanoseconds of the steady clock when the picture is recorded.
+        std::int64_t RecordTime {0};
+        /// Bytes of the picture.
+        std::uint64_t PictureSize {0};
+        /// Picture header encoded by HeaderCoder::EncodeExtended.
+        unsigned char Picture[HeaderCoder::ExtendedHeaderSize] {};
+        /// Metadata published with the picture, with its capture and publication time stamps.
+        FrameMetadata Metadata;
+    };
+}
\ No newline at end of file
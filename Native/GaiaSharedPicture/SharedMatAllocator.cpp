@@ -0,0 +1,126 @@
+#include "SharedMatAllocator.hpp"
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace Gaia::SharedPicture
+{
+    /// Slot of a picture allocated in place, kept in the user data of its cv::UMatData.
+    struct SlotAllocation
+    {
+        /// Index of the held slot.
+        unsigned int Slot;
+        /// Reader counter of the held slot, decreased to release it.
+        std::atomic<std::uint32_t>* Readers;
+        /// Sequence lock of the held slot, HeldSlotSequence until the picture is published.
+        std::atomic<std::uint64_t>* Sequence;
+        /// Mapping of the slot, kept alive after the writer has moved to a newer generation of the block.
+        std::shared_ptr<boost::interprocess::mapped_region> Mapping;
+        /// Header of the allocated picture.
+        PictureHeader Header;
+        /// Bytes between the beginnings of two adjacent rows.
+        std::size_t RowStride;
+        /// Time stamp when the slot is held, in nanoseconds of the steady clock.
+        std::int64_t HoldTime;
+        /// Whether the picture is published.
+        bool Published {false};
+    };
+
+    /// Construct an allocator on the slots of the writer.
+    SharedMatAllocator::SharedMatAllocator(PictureWriter &writer) : Writer(writer)
+    {
+        if (writer.GetOptions().Layout != BlockOptions::Layouts::Ring || writer.GetOptions().QueueMode)
+        {
+            throw std::runtime_error("Failed to construct shared cv::Mat allocator, "
+                                     "it requires a ring layout block which is not in the queue mode.");
+        }
+    }
+
+    /// Allocate a picture in a free slot, or by the default allocator if no slot can hold it.
+    cv::UMatData *SharedMatAllocator::allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                                               cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const
+    {
+        auto* memory = Writer.GetMemoryPointer();
+        if (data || !memory || dims < 2 || dims > static_cast<int>(PictureHeader::MaxDimensions))
+            return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage_flags);
+
+        auto* block = BlockLayout::GetBlockHeader(memory);
+        auto header = HeaderCoder::GetHeader(type, dims, sizes);
+        auto row_stride = BlockLayout::GetRowStride(block, HeaderCoder::GetRowSize(header));
+        if (row_stride * HeaderCoder::GetRowCount(header) > BlockLayout::GetSlotCapacity(block))
+            return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage_flags);
+        auto hold_time = BlockLayout::GetTimeStamp();
+        auto slot = Writer.HoldFreeSlot();
+        if (slot == NoSlot)
+            return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage_flags);
+
+        // Rows are padded to the row alignment of the block, like pictures written by the writer.
+        if (step)
+        {
+            step[dims - 1] = CV_ELEM_SIZE(type);
+            step[dims - 2] = row_stride;
+            for (int dimension = dims - 3; dimension >= 0; --dimension)
+                step[dimension] = step[dimension + 1] * sizes[dimension + 1];
+        }
+        auto* slot_header = BlockLayout::GetSlotHeader(memory, slot);
+        auto* allocation = new SlotAllocation{slot, &slot_header->Readers, &slot_header->Sequence,
+                                              Writer.RegionObject, header, row_stride, hold_time};
+        auto* result = new cv::UMatData(this);
+        result->data = result->origdata = BlockLayout::GetSlotPointer(memory, slot);
+        result->size = row_stride * HeaderCoder::GetRowCount(header);
+        result->userdata = allocation;
+        return result;
+    }
+
+    /// Pictures allocated in slots are always accessible on the host.
+    bool SharedMatAllocator::allocate(cv::UMatData *data, cv::AccessFlag, cv::UMatUsageFlags) const
+    {
+        return data != nullptr;
+    }
+
+    /// Release the slot of a picture allocated in place.
+    void SharedMatAllocator::deallocate(cv::UMatData *data) const
+    {
+        if (!data) return;
+        auto* allocation = static_cast<SlotAllocation*>(data->userdata);
+        // An unpublished slot holds no picture, it is unlocked as empty before the writer can reuse it.
+        if (!allocation->Published) allocation->Sequence->store(0, std::memory_order_release);
+        allocation->Readers->fetch_sub(1);
+        delete allocation;
+        delete data;
+    }
+
+    /// Check whether the picture is allocated in a slot by this allocator.
+    bool SharedMatAllocator::IsShared(const cv::Mat &picture) const
+    {
+        return picture.u && picture.u->currAllocator == this;
+    }
+
+    /// Publish a picture allocated by this allocator.
+    bool SharedMatAllocator::Publish(const cv::Mat &picture, const FrameMetadata *metadata)
+    {
+        if (IsShared(picture))
+        {
+            auto* allocation = static_cast<SlotAllocation*>(picture.u->userdata);
+            if (allocation->Published)
+            {
+                throw std::runtime_error("Failed to publish picture: it is already published.");
+            }
+            unsigned char allocated_header[HeaderCoder::ExtendedHeaderSize];
+            unsigned char picture_header[HeaderCoder::ExtendedHeaderSize];
+            HeaderCoder::EncodeExtended(allocation->Header, allocated_header);
+            HeaderCoder::EncodeExtended(HeaderCoder::GetHeader(picture), picture_header);
+            // Parts of the picture, and slots of a block retired by resizing, are copied instead.
+            if (picture.data == picture.u->origdata && allocation->Mapping == Writer.RegionObject &&
+                std::memcmp(allocated_header, picture_header, sizeof(picture_header)) == 0)
+            {
+                Writer.PublishHeldSlot(allocation->Slot, allocation->Header, allocation->RowStride,
+                                       allocation->HoldTime, metadata);
+                allocation->Published = true;
+                return true;
+            }
+        }
+        return metadata ? Writer.Write(picture, *metadata) : Writer.Write(picture);
+    }
+}
\ No newline at end of file
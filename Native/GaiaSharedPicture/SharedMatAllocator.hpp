@@ -0,0 +1,55 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "PictureWriter.hpp"
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief OpenCV allocator placing pictures directly into the free ring layout slots of a writer.
+     * @details
+     *  Set it as the allocator of the output of an OpenCV function, such as the destination of cv::remap
+     *  or cv::imdecode, and the output is produced in a slot; Publish() then hands the slot to readers
+     *  without copying. A slot holding an allocated picture is held like a reader holds it, until the last
+     *  cv::Mat referring to it is released, so the writer keeps writing into the other slots meanwhile.
+     *  Pictures which can not be placed in a slot, for no slot is free or they are too big, are allocated
+     *  by the default OpenCV allocator, and Publish() copies them like PictureWriter::Write().
+     *  It must be used on the thread of the writer, and outlive the pictures it allocates.
+     */
+    class SharedMatAllocator : public cv::MatAllocator
+    {
+        /// Writer whose slots are allocated.
+        PictureWriter& Writer;
+
+    public:
+        /**
+         * @brief Construct an allocator on the slots of the writer.
+         * @param writer Writer of a ring layout block which is not in the queue mode, it must outlive this allocator.
+         */
+        explicit SharedMatAllocator(PictureWriter& writer);
+
+        /// Allocate a picture in a free slot, or by the default allocator if no slot can hold it.
+        cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                               cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override;
+        /// Pictures allocated in slots are always accessible on the host.
+        bool allocate(cv::UMatData* data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const override;
+        /// Release the slot of a picture allocated in place.
+        void deallocate(cv::UMatData* data) const override;
+
+        /// Check whether the picture is allocated in a slot by this allocator.
+        [[nodiscard]] bool IsShared(const cv::Mat& picture) const;
+
+        /**
+         * @brief Publish a picture allocated by this allocator, without copying it if it is in a slot.
+         * @param picture Picture to publish; a picture in a slot must be the whole allocated picture,
+         *                and it must not be written after it is published.
+         * @param metadata Metadata of the picture, or null for empty metadata.
+         * @retval true The picture is published.
+         * @retval false The picture is not in a slot, and all slots are held, so it is not written.
+         * @throws runtime_error If the picture is already published, a buffer of the writer is acquired,
+         *                       or the picture can not be written like PictureWriter::Write().
+         */
+        bool Publish(const cv::Mat& picture, const FrameMetadata* metadata = nullptr);
+    };
+}
\ No newline at end of file
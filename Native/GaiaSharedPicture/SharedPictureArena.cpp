@@ -0,0 +1,244 @@
+#include "SharedPictureArena.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace Gaia::SharedPicture
+{
+    /// Alignment of stream memory blocks in an arena, a page, so streams never share pages.
+    constexpr std::size_t StreamAlignment = 4096;
+
+    /**
+     * @brief Scoped lock of the directory table of an arena, shared between processes.
+     * @details
+     *  The lock is a robust mutex, so a lock left by a crashed process is handed to the next process taking it.
+     *  A crashed owner may leave allocated space unused, but never a half published entry,
+     *  for entries are only counted after they are completely written.
+     */
+    class DirectoryLock
+    {
+    private:
+        pthread_mutex_t& Lock;
+
+    public:
+        explicit DirectoryLock(pthread_mutex_t& lock) : Lock(lock)
+        {
+            auto result = pthread_mutex_lock(&Lock);
+            if (result == EOWNERDEAD) result = pthread_mutex_consistent(&Lock);
+            if (result != 0)
+                throw std::runtime_error("Failed to lock arena directory: error " + std::to_string(result) + ".");
+        }
+        ~DirectoryLock()
+        {
+            pthread_mutex_unlock(&Lock);
+        }
+    };
+
+    /// Initialize the directory lock of a new arena as a robust mutex shared between processes.
+    static void InitializeDirectoryLock(pthread_mutex_t& lock)
+    {
+        pthread_mutexattr_t attributes;
+        auto result = pthread_mutexattr_init(&attributes);
+        if (result == 0) result = pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        if (result == 0) result = pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+        if (result == 0) result = pthread_mutex_init(&lock, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+        if (result != 0)
+            throw std::runtime_error("Failed to create shared picture arena: directory lock error " +
+                                     std::to_string(result) + ".");
+    }
+
+    /// Check whether a reader holds a slot or a queue cursor of the ring layout block of a stream.
+    static bool IsStreamInUse(unsigned char* memory, std::size_t size)
+    {
+        if (!BlockLayout::IsRing(memory, size)) return false;
+        auto* block = BlockLayout::GetBlockHeader(memory);
+        for (unsigned int slot = 0; slot < block->SlotCount; ++slot)
+        {
+            if (BlockLayout::GetSlotHeader(memory, slot)->Readers.load() != 0) return true;
+        }
+        for (unsigned int index = 0; index < block->QueueReaders; ++index)
+        {
+            if (BlockLayout::IsCursorActive(BlockLayout::GetCursor(memory, index))) return true;
+        }
+        return false;
+    }
+
+    /// Get the entries of the directory table of an arena.
+    static StreamEntry* GetEntries(ArenaHeader* header)
+    {
+        return reinterpret_cast<StreamEntry*>(reinterpret_cast<unsigned char*>(header) + header->DirectoryOffset);
+    }
+
+    /// Create an arena, or reset the existing one with the same name.
+    SharedPictureArena::SharedPictureArena(const std::string &arena_name, std::size_t arena_size,
+                                           unsigned int stream_capacity)
+    {
+        auto directory_offset = BlockLayout::AlignSize(sizeof(ArenaHeader), alignof(StreamEntry));
+        auto used = BlockLayout::AlignSize(directory_offset + stream_capacity * sizeof(StreamEntry),
+                                           StreamAlignment);
+        if (arena_size < used)
+            throw std::runtime_error("Failed to create shared picture arena: size can not hold the directory table.");
+
+        MemoryObject = std::make_unique<boost::interprocess::shared_memory_object>(
+                boost::interprocess::open_or_create, arena_name.c_str(),
+                boost::interprocess::read_write);
+        MemoryObject->truncate(static_cast<boost::interprocess::offset_t>(arena_size));
+        RegionObject = std::make_shared<boost::interprocess::mapped_region>(
+                *MemoryObject,
+                boost::interprocess::read_write);
+
+        auto* header = new (RegionObject->get_address()) ArenaHeader;
+        InitializeDirectoryLock(header->Lock);
+        header->StreamCapacity = stream_capacity;
+        header->DirectoryOffset = directory_offset;
+        header->Size = arena_size;
+        header->Used = used;
+        auto* entries = GetEntries(header);
+        for (unsigned int index = 0; index < stream_capacity; ++index)
+        {
+            new (entries + index) StreamEntry;
+        }
+    }
+
+    /// Open an existing arena.
+    SharedPictureArena::SharedPictureArena(const std::string &arena_name)
+    {
+        try
+        {
+            MemoryObject = std::make_unique<boost::interprocess::shared_memory_object>(
+                    boost::interprocess::open_only, arena_name.c_str(),
+                    boost::interprocess::read_write);
+            RegionObject = std::make_shared<boost::interprocess::mapped_region>(
+                    *MemoryObject,
+                    boost::interprocess::read_write);
+        }catch(boost::interprocess::interprocess_exception&)
+        {
+            MemoryObject = std::make_unique<boost::interprocess::shared_memory_object>(
+                    boost::interprocess::open_only, arena_name.c_str(),
+                    boost::interprocess::read_only);
+            RegionObject = std::make_shared<boost::interprocess::mapped_region>(
+                    *MemoryObject,
+                    boost::interprocess::read_only);
+        }
+        const auto* header = GetHeader();
+        if (RegionObject->get_size() < sizeof(ArenaHeader) ||
+            header->Magic != ArenaMagic || header->Version != ArenaVersion ||
+            header->Size > RegionObject->get_size() ||
+            header->DirectoryOffset + header->StreamCapacity * sizeof(StreamEntry) > header->Size)
+        {
+            throw std::runtime_error("Failed to open shared picture arena: arena header is broken.");
+        }
+    }
+
+    /// Get the header of the arena.
+    ArenaHeader* SharedPictureArena::GetHeader() const
+    {
+        return static_cast<ArenaHeader*>(RegionObject->get_address());
+    }
+
+    /// Get the entry of the stream with the given name.
+    StreamEntry* SharedPictureArena::FindStream(const std::string &stream_name) const
+    {
+        auto* header = GetHeader();
+        auto* entries = GetEntries(header);
+        auto count = std::min(header->StreamCount.load(std::memory_order_acquire), header->StreamCapacity);
+        for (std::uint32_t index = 0; index < count; ++index)
+        {
+            if (std::strncmp(entries[index].Name, stream_name.c_str(), MaxStreamNameSize) == 0)
+                return entries + index;
+        }
+        return nullptr;
+    }
+
+    /// Create a stream in the arena.
+    PictureWriter SharedPictureArena::CreateStream(const std::string &stream_name, unsigned int max_picture_size,
+                                                   const BlockOptions &options)
+    {
+        if (stream_name.empty() || stream_name.size() >= MaxStreamNameSize)
+            throw std::runtime_error("Failed to create stream: name must have 1 to " +
+                                     std::to_string(MaxStreamNameSize - 1) + " characters.");
+        if (RegionObject->get_mode() != boost::interprocess::read_write)
+            throw std::runtime_error("Failed to create stream: arena is opened in read-only mode.");
+        // Streams are blocks at fixed offsets of the arena, they can not move to a bigger generation.
+        if (options.Resizable)
+            throw std::runtime_error("Failed to create stream: streams of an arena can not be resizable.");
+
+        auto block_size = PictureWriter::GetBlockSize(max_picture_size, options);
+        auto alignment = std::max<std::size_t>(StreamAlignment, options.PayloadAlignment);
+        auto* header = GetHeader();
+        DirectoryLock lock(header->Lock);
+
+        if (auto* entry = FindStream(stream_name))
+        {
+            if (entry->Size < block_size)
+                throw std::runtime_error("Failed to create stream: existing stream " + stream_name + " is too small.");
+            if (IsStreamInUse(static_cast<unsigned char*>(RegionObject->get_address()) + entry->Offset, entry->Size))
+                throw std::runtime_error("Failed to create stream: existing stream " + stream_name +
+                                         " is in use by readers.");
+            entry->MaxPictureSize = max_picture_size;
+            return PictureWriter(RegionObject, entry->Offset, entry->Size, max_picture_size, true, options);
+        }
+
+        auto index = header->StreamCount.load(std::memory_order_relaxed);
+        if (index >= header->StreamCapacity)
+            throw std::runtime_error("Failed to create stream: directory table of the arena is full.");
+        auto offset = BlockLayout::AlignSize(header->Used, alignment);
+        if (offset + block_size > header->Size)
+            throw std::runtime_error("Failed to create stream: insufficient arena space for " +
+                                     std::to_string(block_size) + " bytes.");
+
+        // The block is initialized before the entry is published, so readers never open a half created stream.
+        PictureWriter writer(RegionObject, offset, block_size, max_picture_size, true, options);
+        auto& entry = GetEntries(header)[index];
+        std::memset(entry.Name, 0, MaxStreamNameSize);
+        std::memcpy(entry.Name, stream_name.data(), stream_name.size());
+        entry.Offset = offset;
+        entry.Size = block_size;
+        entry.MaxPictureSize = max_picture_size;
+        header->Used = offset + block_size;
+        header->StreamCount.store(index + 1, std::memory_order_release);
+        return writer;
+    }
+
+    /// Open a reader of a stream in the arena.
+    PictureReader SharedPictureArena::OpenStream(const std::string &stream_name) const
+    {
+        auto* entry = FindStream(stream_name);
+        if (!entry) throw std::runtime_error("Failed to open stream: no stream named " + stream_name + ".");
+        if (entry->Offset + entry->Size > GetHeader()->Size)
+            throw std::runtime_error("Failed to open stream: stream " + stream_name + " exceeds the arena.");
+        return PictureReader(RegionObject, entry->Offset, entry->Size);
+    }
+
+    /// Check whether a stream with the given name exists or not.
+    bool SharedPictureArena::HasStream(const std::string &stream_name) const
+    {
+        return FindStream(stream_name) != nullptr;
+    }
+
+    /// Get the names of all streams in the arena.
+    std::vector<std::string> SharedPictureArena::ListStreams() const
+    {
+        auto* header = GetHeader();
+        auto* entries = GetEntries(header);
+        auto count = std::min(header->StreamCount.load(std::memory_order_acquire), header->StreamCapacity);
+        std::vector<std::string> names;
+        names.reserve(count);
+        for (std::uint32_t index = 0; index < count; ++index)
+        {
+            const auto* name = entries[index].Name;
+            names.emplace_back(name, std::find(name, name + MaxStreamNameSize, '\0'));
+        }
+        return names;
+    }
+
+    /// Remove the shared memory block of an arena.
+    void SharedPictureArena::Remove(const std::string &arena_name)
+    {
+        boost::interprocess::shared_memory_object::remove(arena_name.c_str());
+    }
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <pthread.h>
+
+#include "PictureReader.hpp"
+#include "PictureWriter.hpp"
+
+namespace Gaia::SharedPicture
+{
+    /// Magic number at the beginning of an arena, "GSPA" in little endian.
+    constexpr std::uint32_t ArenaMagic = 0x41505347;
+    /// Version of the arena layout.
+    constexpr std::uint32_t ArenaVersion = 1;
+    /// Max bytes of a stream name, including the terminating zero.
+    constexpr std::size_t MaxStreamNameSize = 64;
+
+    /// Header at the beginning of an arena.
+    struct ArenaHeader
+    {
+        /// Magic number, must be ArenaMagic.
+        std::uint32_t Magic {ArenaMagic};
+        /// Version of the layout.
+        std::uint32_t Version {ArenaVersion};
+        /// Max count of streams in the directory table.
+        std::uint32_t StreamCapacity {0};
+        /**
+         * @brief Lock of the directory table and the allocation, only taken while creating streams.
+         * @details It is a robust mutex shared between processes, so it is recovered from a dead owner.
+         */
+        pthread_mutex_t Lock;
+        /// Count of streams in the directory table, increased after a stream is completely created.
+        std::atomic<std::uint32_t> StreamCount {0};
+        /// Offset of the directory table from the beginning of the arena.
+        std::uint64_t DirectoryOffset {0};
+        /// Bytes of the arena.
+        std::uint64_t Size {0};
+        /// Bytes allocated from the beginning of the arena, including this header and the directory table.
+        std::uint64_t Used {0};
+    };
+
+    /// Entry of a stream in the directory table of an arena.
+    struct StreamEntry
+    {
+        /// Name of the stream, terminated by zero.
+        char Name[MaxStreamNameSize] {};
+        /// Offset of the memory block of the stream from the beginning of the arena.
+        std::uint64_t Offset {0};
+        /// Bytes of the memory block of the stream.
+        std::uint64_t Size {0};
+        /// Picture part size of the memory block of the stream.
+        std::uint32_t MaxPictureSize {0};
+    };
+
+    /**
+     * @brief Shared picture arena holding many named picture streams in one shared memory block.
+     * @details
+     *  Every stream is a memory block in the single or the ring layout, listed in the directory table of the arena,
+     *  so a process maps all streams at once and can discover them by ListStreams().
+     *  Writers and readers of streams share the mapping of the arena, which is unmapped after all of them
+     *  and the arena are destroyed.
+     */
+    class SharedPictureArena
+    {
+    private:
+        /// Shared memory management object.
+        std::unique_ptr<boost::interprocess::shared_memory_object> MemoryObject;
+        /// Shared memory accessor object, shared with the writers and readers of streams.
+        std::shared_ptr<boost::interprocess::mapped_region> RegionObject;
+
+        /// Get the header of the arena.
+        [[nodiscard]] ArenaHeader* GetHeader() const;
+        /// Get the entry of the stream with the given name, or nullptr if it does not exist.
+        [[nodiscard]] StreamEntry* FindStream(const std::string& stream_name) const;
+
+    public:
+        /**
+         * @brief Create an arena, or reset the existing one with the same name.
+         * @param arena_name Name of the shared memory block of the arena.
+         * @param arena_size Bytes of the arena, including its directory table.
+         * @param stream_capacity Max count of streams.
+         * @throws runtime_error If the arena size can not hold the directory table.
+         */
+        SharedPictureArena(const std::string& arena_name, std::size_t arena_size, unsigned int stream_capacity = 128);
+
+        /**
+         * @brief Open an existing arena, in read-write mode if permitted, otherwise in read-only mode.
+         * @param arena_name Name of the shared memory block of the arena.
+         * @throws runtime_error If the arena does not exist or is broken.
+         */
+        explicit SharedPictureArena(const std::string& arena_name);
+
+        /**
+         * @brief Create a stream in the arena, or reset the existing stream with the same name.
+         * @param stream_name Name of the stream, shorter than MaxStreamNameSize bytes.
+         * @param max_picture_size Picture part size of the stream, see PictureWriter::PictureWriter().
+         * @param options Layout options of the stream, streams can not be resizable.
+         * @return Writer of the stream.
+         * @throws runtime_error If the name is too long, the options are resizable, the arena is full,
+         *                       or the existing stream is too small or has slots held by readers.
+         * @details
+         *  Resetting an existing stream initializes its block again, so readers must not consume it meanwhile;
+         *  it is refused while a reader holds a slot or a queue cursor of the stream.
+         */
+        PictureWriter CreateStream(const std::string& stream_name, unsigned int max_picture_size,
+                                   const BlockOptions& options = BlockOptions());
+
+        /**
+         * @brief Open a reader of a stream in the arena.
+         * @param stream_name Name of the stream.
+         * @return Reader of the stream.
+         * @throws runtime_error If the stream does not exist.
+         */
+        PictureReader OpenStream(const std::string& stream_name) const;
+
+        /// Check whether a stream with the given name exists or not.
+        [[nodiscard]] bool HasStream(const std::string& stream_name) const;
+
+        /// Get the names of all streams in the arena.
+        [[nodiscard]] std::vector<std::string> ListStreams() const;
+
+        /// Remove the shared memory block of an arena, mapped streams keep working until they are destroyed.
+        static void Remove(const std::string& arena_name);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <opencv2/opencv.hpp>
+
+#include "HeaderCoder.hpp"
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Pixel format known at compile time, described by the element type and the count of channels.
+     * @tparam Element Arithmetic type of a channel, such as std::uint8_t or float.
+     * @tparam Channels Count of channels.
+     */
+    template <typename Element, int Channels>
+    struct TypedPixel
+    {
+        static_assert(std::is_arithmetic_v<Element> && !std::is_same_v<Element, bool> &&
+                      (sizeof(Element) == 1 || sizeof(Element) == 2 || sizeof(Element) == 4 || sizeof(Element) == 8),
+                      "Element must be an integer or floating point type of 8, 16, 32 or 64 bits.");
+        static_assert(Channels >= 1 && Channels <= CV_CN_MAX, "Channels must be in [1, CV_CN_MAX].");
+
+        /// Type of a pixel, the element itself for single channel pictures.
+        using Type = std::conditional_t<Channels == 1, Element, cv::Vec<Element, Channels>>;
+
+        /// Bits of a channel in the picture header.
+        static constexpr PictureHeader::PixelBitSizes PixelBits =
+                sizeof(Element) == 1 ? PictureHeader::PixelBitSizes::Bits8 :
+                sizeof(Element) == 2 ? PictureHeader::PixelBitSizes::Bits16 :
+                sizeof(Element) == 4 ? PictureHeader::PixelBitSizes::Bits32 : PictureHeader::PixelBitSizes::Bits64;
+        /// Value type of a channel in the picture header.
+        static constexpr PictureHeader::PixelTypes PixelType =
+                std::is_floating_point_v<Element> ? PictureHeader::PixelTypes::Float :
+                std::is_signed_v<Element> ? PictureHeader::PixelTypes::Signed : PictureHeader::PixelTypes::Unsigned;
+
+        /// Check whether the header describes 2-dimensional pictures of this pixel format.
+        static bool Matches(const PictureHeader& header) noexcept
+        {
+            return header.Dimensions == 2 && header.Channels == static_cast<unsigned int>(Channels) &&
+                   header.PixelBits == PixelBits && header.PixelType == PixelType;
+        }
+
+        /// Get the header of a picture of this pixel format with the given size.
+        static PictureHeader GetHeader(int width, int height) noexcept
+        {
+            PictureHeader header;
+            header.PixelBits = PixelBits;
+            header.PixelType = PixelType;
+            header.Channels = static_cast<unsigned int>(Channels);
+            header.Width = static_cast<unsigned int>(width);
+            header.Height = static_cast<unsigned int>(height);
+            return header;
+        }
+    };
+
+    /**
+     * @brief View of a 2-dimensional picture with a pixel format known at compile time, without an OpenCV header.
+     * @tparam Pixel Type of a pixel, const for read-only views.
+     * @details A view does not own its pixels, it is valid as long as the picture it is taken from.
+     */
+    template <typename Pixel>
+    class TypedPictureView
+    {
+        /// Byte type with the constness of the pixel.
+        using Byte = std::conditional_t<std::is_const_v<Pixel>, const unsigned char, unsigned char>;
+
+        /// First pixel of the picture.
+        Pixel* Data {nullptr};
+        /// Count of rows.
+        int Rows {0};
+        /// Count of columns.
+        int Columns {0};
+        /// Bytes between the beginnings of two adjacent rows.
+        std::size_t RowStride {0};
+        /// Sequence number of the picture, 0 if it is not published yet.
+        std::uint64_t Sequence {0};
+
+    public:
+        /// Construct an empty view.
+        TypedPictureView() = default;
+        /// Construct a view on the given pixels.
+        TypedPictureView(Pixel* data, int rows, int columns, std::size_t row_stride, std::uint64_t sequence) noexcept:
+            Data(data), Rows(rows), Columns(columns), RowStride(row_stride), Sequence(sequence)
+        {}
+
+        /// Check whether this view has pixels or not.
+        [[nodiscard]] inline bool IsValid() const noexcept
+        {
+            return Data != nullptr;
+        }
+        /// Check whether this view has pixels or not.
+        explicit operator bool() const noexcept
+        {
+            return IsValid();
+        }
+
+        /// Get the first pixel of the given row.
+        [[nodiscard]] inline Pixel* GetRow(int row) const noexcept
+        {
+            return reinterpret_cast<Pixel*>(reinterpret_cast<Byte*>(Data) + static_cast<std::size_t>(row) * RowStride);
+        }
+        /// Get the pixel at the given row and column.
+        inline Pixel& operator()(int row, int column) const noexcept
+        {
+            return GetRow(row)[column];
+        }
+
+        /// Get the first pixel of the picture.
+        [[nodiscard]] inline Pixel* GetData() const noexcept
+        {
+            return Data;
+        }
+        /// Get the count of rows.
+        [[nodiscard]] inline int GetRows() const noexcept
+        {
+            return Rows;
+        }
+        /// Get the count of columns.
+        [[nodiscard]] inline int GetColumns() const noexcept
+        {
+            return Columns;
+        }
+        /// Get the bytes between the beginnings of two adjacent rows.
+        [[nodiscard]] inline std::size_t GetRowStride() const noexcept
+        {
+            return RowStride;
+        }
+        /// Get the sequence number of the picture, 0 if it is not published yet.
+        [[nodiscard]] inline std::uint64_t GetSequence() const noexcept
+        {
+            return Sequence;
+        }
+
+        /// Construct an OpenCV picture aliasing the pixels, for OpenCV functions; it must not be written if read-only.
+        [[nodiscard]] cv::Mat_<std::remove_const_t<Pixel>> GetMat() const
+        {
+            if (!Data) return {};
+            return cv::Mat_<std::remove_const_t<Pixel>>(Rows, Columns, const_cast<std::remove_const_t<Pixel>*>(Data),
+                                                        RowStride);
+        }
+    };
+}
\ No newline at end of file
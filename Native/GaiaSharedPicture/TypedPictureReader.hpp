@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "PictureReader.hpp"
+#include "TypedPicture.hpp"
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Reader of a ring layout block whose pictures have a pixel format known at compile time.
+     * @tparam Element Arithmetic type of a channel, such as std::uint8_t or float.
+     * @tparam Channels Count of channels.
+     * @details
+     *  Pictures are read as typed views aliasing the held slot, without constructing OpenCV headers.
+     *  The header of a slot is only decoded and checked when its encoded bytes differ from the last checked one,
+     *  so a stream of a fixed format is checked once, and reading the newest picture again only costs a load
+     *  of the sequence number.
+     */
+    template <typename Element, int Channels>
+    class TypedPictureReader : public PictureReader
+    {
+    public:
+        /// Type of a pixel, such as cv::Vec3b for TypedPictureReader<std::uint8_t, 3>.
+        using Pixel = typename TypedPixel<Element, Channels>::Type;
+        /// Read-only view of a picture.
+        using View = TypedPictureView<const Pixel>;
+
+    private:
+        /// Header of the mapped block, validated when it is mapped.
+        BlockHeader* Block {nullptr};
+        /// Headers of the slots of the mapped block.
+        std::vector<SlotHeader*> SlotHeaders;
+        /// Picture bytes of the slots of the mapped block.
+        std::vector<const Pixel*> SlotPixels;
+        /// Encoded header of the last checked slot.
+        unsigned char CheckedHeader[HeaderCoder::ExtendedHeaderSize] {};
+        /// Row stride of the last checked slot.
+        std::uint64_t CheckedRowStride {0};
+        /// View of the last read picture, whose slot is held.
+        View LastView;
+
+        /// Check that the mapped block can be leased, then remember its header and slots.
+        void CacheBlock()
+        {
+            if (!IsRing())
+            {
+                throw std::runtime_error("Failed to open typed picture reader, typed readers require the ring layout.");
+            }
+            if (RegionObject->get_mode() != boost::interprocess::read_write)
+            {
+                throw std::runtime_error("Failed to open typed picture reader, "
+                                         "ring layout block is opened in read-only mode.");
+            }
+            if (IsQueue())
+            {
+                throw std::runtime_error("Failed to open typed picture reader, "
+                                         "slots can not be held in the queue mode.");
+            }
+            auto* memory = GetMemoryPointer();
+            Block = BlockLayout::GetBlockHeader(memory);
+            SlotHeaders.resize(Block->SlotCount);
+            SlotPixels.resize(Block->SlotCount);
+            for (unsigned int slot = 0; slot < Block->SlotCount; ++slot)
+            {
+                SlotHeaders[slot] = BlockLayout::GetSlotHeader(memory, slot);
+                SlotPixels[slot] = reinterpret_cast<const Pixel*>(BlockLayout::GetSlotPointer(memory, slot));
+            }
+            // Slots of another block are checked again.
+            std::memset(CheckedHeader, 0, sizeof(CheckedHeader));
+            CheckedRowStride = 0;
+        }
+
+        /// Decode and check the header of the slot, then remember it.
+        void CheckSlotHeader(const SlotHeader* slot_header)
+        {
+            if (slot_header->Codec != PayloadCodecs::Raw)
+            {
+                throw std::runtime_error("Failed to read typed picture, the picture is encoded.");
+            }
+            PictureHeader header;
+            if (!HeaderCoder::DecodeExtended(slot_header->Picture, header))
+            {
+                throw std::runtime_error("Failed to read typed picture, header information decoding failed.");
+            }
+            if (!TypedPixel<Element, Channels>::Matches(header))
+            {
+                throw std::runtime_error("Failed to read typed picture, "
+                                         "the picture does not have the pixel format of the reader.");
+            }
+            if (slot_header->RowStride < HeaderCoder::GetRowSize(header) ||
+                (slot_header->RowStride != 0 &&
+                 header.Height > BlockLayout::GetSlotCapacity(Block) / slot_header->RowStride))
+            {
+                throw std::runtime_error("Failed to read typed picture, the row stride in the slot is broken.");
+            }
+            std::memcpy(CheckedHeader, slot_header->Picture, sizeof(CheckedHeader));
+            CheckedRowStride = slot_header->RowStride;
+            LastView = View(nullptr, static_cast<int>(header.Height), static_cast<int>(header.Width),
+                            CheckedRowStride, 0);
+        }
+
+    public:
+        /**
+         * @brief Open the ring layout block and construct a typed reader on it.
+         * @param shared_block_name Name of the shared memory block.
+         * @param mapping Mapping options matching the ones of the writer.
+         * @throws runtime_error If the block can not be opened, it is not in the ring layout,
+         *                       or it is opened in read-only mode or in the queue mode.
+         */
+        explicit TypedPictureReader(const std::string& shared_block_name,
+                                    const MappingOptions& mapping = MappingOptions()):
+            PictureReader(shared_block_name, mapping)
+        {
+            CacheBlock();
+        }
+
+        /// Copy constructor, the copy maps the block again.
+        TypedPictureReader(const TypedPictureReader& target) : PictureReader(target)
+        {
+            CacheBlock();
+        }
+        /// Move constructor.
+        TypedPictureReader(TypedPictureReader&& target) noexcept : PictureReader(std::move(target)),
+            Block(target.Block), SlotHeaders(std::move(target.SlotHeaders)), SlotPixels(std::move(target.SlotPixels)),
+            CheckedRowStride(target.CheckedRowStride), LastView(target.LastView)
+        {
+            std::memcpy(CheckedHeader, target.CheckedHeader, sizeof(CheckedHeader));
+        }
+        TypedPictureReader& operator=(const TypedPictureReader&) = delete;
+        TypedPictureReader& operator=(TypedPictureReader&&) = delete;
+
+        /**
+         * @brief Read the newest picture without copying it.
+         * @return View of the picture in the held slot, valid until the next read, or an empty view if nothing
+         *         is published yet.
+         * @throws runtime_error If the picture does not have the pixel format of this reader, or it is encoded.
+         * @details
+         *  The block is validated when it is mapped, so a read only holds the latest slot through the cached
+         *  slot headers. Reads are counted in the statistics of the block, but the read lag is not sampled.
+         */
+        View Read()
+        {
+            // A resized block is followed, then its layout is validated and cached once.
+            if (Block->NextGeneration.load(std::memory_order_acquire) != 0 && FollowGeneration()) CacheBlock();
+            // The newest picture is still the held one.
+            if (HeldLease && Block->Sequence.load(std::memory_order_acquire) == LastView.GetSequence())
+                return LastView;
+
+            HeldLease.Release();
+            // Hold the latest slot, then check whether it is still the latest one,
+            // for the writer may have started to overwrite it before it is held.
+            auto slot = Block->LatestSlot.load();
+            while (slot != NoSlot)
+            {
+                SlotHeaders[slot]->Readers.fetch_add(1);
+                auto latest_slot = Block->LatestSlot.load();
+                if (latest_slot == slot) break;
+                SlotHeaders[slot]->Readers.fetch_sub(1);
+                slot = latest_slot;
+            }
+            if (slot == NoSlot) return View();
+            auto* slot_header = SlotHeaders[slot];
+            HeldLease = AdoptSlot(slot_header, slot);
+            LastSequence = HeldLease.GetSequence();
+            Block->Statistics.ReadPictures.fetch_add(1, std::memory_order_relaxed);
+
+            if (slot_header->RowStride != CheckedRowStride ||
+                std::memcmp(slot_header->Picture, CheckedHeader, sizeof(CheckedHeader)) != 0 ||
+                slot_header->Codec != PayloadCodecs::Raw)
+                CheckSlotHeader(slot_header);
+            LastView = View(SlotPixels[slot], LastView.GetRows(), LastView.GetColumns(), CheckedRowStride,
+                            HeldLease.GetSequence());
+            return LastView;
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "PictureWriter.hpp"
+#include "TypedPicture.hpp"
+
+namespace Gaia::SharedPicture
+{
+    /**
+     * @brief Writer of pictures with a pixel format and a size fixed at compile time and construction time.
+     * @tparam Element Arithmetic type of a channel, such as std::uint8_t or float.
+     * @tparam Channels Count of channels.
+     * @details
+     *  The picture header is built once at construction, and acquired buffers are returned as typed views,
+     *  so producers write pixels in place without constructing OpenCV headers.
+     */
+    template <typename Element, int Channels>
+    class TypedPictureWriter : public PictureWriter
+    {
+    public:
+        /// Type of a pixel, such as cv::Vec3b for TypedPictureWriter<std::uint8_t, 3>.
+        using Pixel = typename TypedPixel<Element, Channels>::Type;
+        /// Writable view of a picture.
+        using View = TypedPictureView<Pixel>;
+
+    private:
+        /// Header of all written pictures.
+        PictureHeader Header;
+
+        /// Get the max picture size of pictures with the given size, including the padding of aligned rows.
+        static unsigned int GetMaxPictureSize(int width, int height, const BlockOptions& options)
+        {
+            if (width <= 0 || height <= 0)
+            {
+                throw std::runtime_error("Failed to create typed picture writer, the picture size must be positive.");
+            }
+            auto row_size = static_cast<std::size_t>(width) * sizeof(Pixel);
+            if (options.Layout == BlockOptions::Layouts::Ring && options.RowAlignment > 1)
+                row_size = (row_size + options.RowAlignment - 1) / options.RowAlignment * options.RowAlignment;
+            if (row_size > std::numeric_limits<unsigned int>::max() / static_cast<std::size_t>(height))
+            {
+                throw std::runtime_error("Failed to create typed picture writer, the picture size exceeds "
+                                         "the max picture size of a block.");
+            }
+            return static_cast<unsigned int>(row_size * static_cast<std::size_t>(height));
+        }
+
+    public:
+        /**
+         * @brief Create or open the shared memory block and construct a typed writer on it.
+         * @param shared_block_name Name of the shared memory block.
+         * @param width Width of all pictures.
+         * @param height Height of all pictures.
+         * @param create If false, then only try to open the existing memory block.
+         * @param options Layout options of the memory block to create.
+         * @param mapping Mapping options of the memory block.
+         * @throws runtime_error If the size is not positive or too large, or the block can not be created or opened.
+         */
+        TypedPictureWriter(const std::string& shared_block_name, int width, int height, bool create = true,
+                           const BlockOptions& options = BlockOptions(),
+                           const MappingOptions& mapping = MappingOptions()):
+            PictureWriter(shared_block_name, GetMaxPictureSize(width, height, options), create, options, mapping),
+            Header(TypedPixel<Element, Channels>::GetHeader(width, height))
+        {}
+
+        /// Get the width of all pictures.
+        [[nodiscard]] inline int GetWidth() const noexcept
+        {
+            return static_cast<int>(Header.Width);
+        }
+        /// Get the height of all pictures.
+        [[nodiscard]] inline int GetHeight() const noexcept
+        {
+            return static_cast<int>(Header.Height);
+        }
+
+        /**
+         * @brief Acquire a picture buffer in the shared memory block, see PictureWriter::AcquireWriteBuffer().
+         * @return Writable view of the buffer, or an empty view if all ring layout slots are held.
+         * @throws runtime_error If the last buffer is not committed.
+         * @details Write the pixels through the view, then call Commit() to publish them, or Cancel().
+         */
+        View Acquire()
+        {
+            auto buffer = AcquireWriteBuffer(Header);
+            if (buffer.empty()) return View();
+            return View(reinterpret_cast<Pixel*>(buffer.data), buffer.rows, buffer.cols, buffer.step[0], 0);
+        }
+    };
+}
\ No newline at end of file
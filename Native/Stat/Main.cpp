@@ -0,0 +1,144 @@
+#include <GaiaSharedPicture/GaiaSharedPicture.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+using namespace Gaia::SharedPicture;
+
+/// Snapshot of the statistics of a block.
+struct Snapshot
+{
+    std::uint64_t WrittenPictures;
+    std::uint64_t WrittenBytes;
+    std::uint64_t WriteTime;
+    std::uint64_t RefusedWrites;
+    std::uint64_t ReadPictures;
+    std::uint64_t TornReads;
+    std::uint64_t DroppedPictures;
+    std::uint64_t WriteLatency[BlockStatistics::HistogramBuckets];
+    std::uint64_t ReadLag[BlockStatistics::HistogramBuckets];
+};
+
+/// Take a snapshot of the statistics.
+Snapshot TakeSnapshot(const BlockStatistics& statistics)
+{
+    Snapshot snapshot {};
+    snapshot.WrittenPictures = statistics.WrittenPictures.load(std::memory_order_relaxed);
+    snapshot.WrittenBytes = statistics.WrittenBytes.load(std::memory_order_relaxed);
+    snapshot.WriteTime = statistics.WriteTime.load(std::memory_order_relaxed);
+    snapshot.RefusedWrites = statistics.RefusedWrites.load(std::memory_order_relaxed);
+    snapshot.ReadPictures = statistics.ReadPictures.load(std::memory_order_relaxed);
+    snapshot.TornReads = statistics.TornReads.load(std::memory_order_relaxed);
+    snapshot.DroppedPictures = statistics.DroppedPictures.load(std::memory_order_relaxed);
+    for (unsigned int bucket = 0; bucket < BlockStatistics::HistogramBuckets; ++bucket)
+    {
+        snapshot.WriteLatency[bucket] = statistics.WriteLatency[bucket].load(std::memory_order_relaxed);
+        snapshot.ReadLag[bucket] = statistics.ReadLag[bucket].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+/**
+ * @brief Get the value at the given percentile of the histogram counted between two snapshots.
+ * @return Upper bound in microseconds of the bucket holding the percentile, or 0 if nothing is counted.
+ */
+double GetPercentile(const std::uint64_t* current, const std::uint64_t* previous, double percentile)
+{
+    std::uint64_t total = 0;
+    for (unsigned int bucket = 0; bucket < BlockStatistics::HistogramBuckets; ++bucket)
+        total += current[bucket] - previous[bucket];
+    if (total == 0) return 0.0;
+    auto rank = static_cast<std::uint64_t>(percentile * static_cast<double>(total - 1)) + 1;
+    std::uint64_t count = 0;
+    for (unsigned int bucket = 0; bucket < BlockStatistics::HistogramBuckets; ++bucket)
+    {
+        count += current[bucket] - previous[bucket];
+        if (count >= rank) return static_cast<double>(std::uint64_t(1) << (bucket + 1)) / 1000.0;
+    }
+    return static_cast<double>(std::uint64_t(1) << BlockStatistics::HistogramBuckets) / 1000.0;
+}
+
+/// Print the usage of this tool.
+void PrintUsage()
+{
+    std::cerr << "Usage: gaia-shared-picture-stat <block name> [interval ms] [count] [huge page directory]\n"
+              << "  Print the rates of a ring layout block every interval, 1000 ms by default,\n"
+              << "  for the given count of intervals, or until it is interrupted if the count is 0."
+              << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+    auto interval = std::chrono::milliseconds(argc > 2 ? std::max(1, std::atoi(argv[2])) : 1000);
+    auto count = argc > 3 ? std::max(0, std::atoi(argv[3])) : 0;
+    MappingOptions mapping;
+    mapping.ReadOnly = true;
+    if (argc > 4) mapping.HugePageDirectory = argv[4];
+
+    try
+    {
+        PictureReader reader(argv[1], mapping);
+        const auto* statistics = reader.GetStatistics();
+        if (!statistics)
+        {
+            std::cerr << "Block " << argv[1] << " is not in the ring layout, it has no statistics." << std::endl;
+            return 1;
+        }
+        const auto* block = BlockLayout::GetBlockHeader(reader.GetMemoryPointer());
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "writes/s MB/s write_us write_p50_us write_p99_us refused/s "
+                  << "reads/s torn/s dropped/s lag_p50_us lag_p99_us sequence waiters cursors" << std::endl;
+        auto previous = TakeSnapshot(*statistics);
+        auto previous_time = std::chrono::steady_clock::now();
+        for (int index = 0; count == 0 || index < count; ++index)
+        {
+            std::this_thread::sleep_for(interval);
+            auto current = TakeSnapshot(*statistics);
+            auto current_time = std::chrono::steady_clock::now();
+            auto seconds = std::chrono::duration<double>(current_time - previous_time).count();
+
+            auto written = current.WrittenPictures - previous.WrittenPictures;
+            auto write_time = written != 0 ?
+                    static_cast<double>(current.WriteTime - previous.WriteTime) / static_cast<double>(written) / 1000.0 :
+                    0.0;
+            unsigned int cursors = 0;
+            for (unsigned int cursor = 0; cursor < block->QueueReaders; ++cursor)
+            {
+                if (BlockLayout::IsCursorActive(BlockLayout::GetCursor(reader.GetMemoryPointer(), cursor)))
+                    ++cursors;
+            }
+
+            std::cout << static_cast<double>(written) / seconds << " "
+                      << static_cast<double>(current.WrittenBytes - previous.WrittenBytes) / seconds / 1e6 << " "
+                      << write_time << " "
+                      << GetPercentile(current.WriteLatency, previous.WriteLatency, 0.5) << " "
+                      << GetPercentile(current.WriteLatency, previous.WriteLatency, 0.99) << " "
+                      << static_cast<double>(current.RefusedWrites - previous.RefusedWrites) / seconds << " "
+                      << static_cast<double>(current.ReadPictures - previous.ReadPictures) / seconds << " "
+                      << static_cast<double>(current.TornReads - previous.TornReads) / seconds << " "
+                      << static_cast<double>(current.DroppedPictures - previous.DroppedPictures) / seconds << " "
+                      << GetPercentile(current.ReadLag, previous.ReadLag, 0.5) << " "
+                      << GetPercentile(current.ReadLag, previous.ReadLag, 0.99) << " "
+                      << block->Sequence.load(std::memory_order_relaxed) << " "
+                      << block->Waiters.load(std::memory_order_relaxed) << " "
+                      << cursors << std::endl;
+            previous = current;
+            previous_time = current_time;
+        }
+    }catch(std::exception& error)
+    {
+        std::cerr << "Failed to monitor block " << argv[1] << ": " << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
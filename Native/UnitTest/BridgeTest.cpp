@@ -0,0 +1,132 @@
+#include "RingBlock.hpp"
+#include <Bridge/BridgeReceiver.hpp>
+#include <Bridge/BridgeSender.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace Gaia::SharedPicture;
+using namespace Gaia::SharedPicture::UnitTest;
+
+namespace
+{
+    /// Count of pictures streamed over the bridge.
+    constexpr std::uint64_t BridgedPictures = 200;
+    /// Max time the test waits on a socket, so a failed child process can not hang it.
+    constexpr timeval SocketTimeout {20, 0};
+
+    /// Open a TCP socket listening on an ephemeral port of the loopback address, and get the port.
+    int OpenListener(std::uint16_t& port)
+    {
+        auto descriptor = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t address_size = sizeof(address);
+        if (descriptor < 0 ||
+            ::setsockopt(descriptor, SOL_SOCKET, SO_RCVTIMEO, &SocketTimeout, sizeof(SocketTimeout)) != 0 ||
+            ::bind(descriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(descriptor, 1) != 0 ||
+            ::getsockname(descriptor, reinterpret_cast<sockaddr*>(&address), &address_size) != 0)
+        {
+            if (descriptor >= 0) ::close(descriptor);
+            return -1;
+        }
+        port = ntohs(address.sin_port);
+        return descriptor;
+    }
+
+    /// Stream the pictures of the source block to the port until the last one is sent, run in a child process.
+    int RunSender(const std::string& source_name, std::uint16_t port)
+    {
+        auto descriptor = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        if (descriptor < 0 || ::connect(descriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+            return 2;
+        try
+        {
+            PictureReader reader(source_name);
+            BridgeSenderOptions options;
+            options.BatchSize = 2;
+            options.ZeroCopyThreshold = 0;
+            BridgeSender sender(reader, descriptor, options);
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+            while (reader.GetLastSequence() < BridgedPictures && std::chrono::steady_clock::now() < deadline)
+                sender.SendBatch(std::chrono::milliseconds(100));
+            return reader.GetLastSequence() == BridgedPictures && sender.Flush(std::chrono::seconds(5)) ? 0 : 3;
+        }catch(std::exception&)
+        {
+            return 4;
+        }
+    }
+}
+
+TEST(BridgeTest, StreamsPicturesBetweenProcessesOverLoopback)
+{
+    RingBlock source("gaia_unit_test_bridge_source", 5, 320 * 240 * 3);
+    RingBlock destination("gaia_unit_test_bridge_destination", 3, 320 * 240 * 3);
+    std::uint16_t port = 0;
+    auto listener = OpenListener(port);
+    ASSERT_GE(listener, 0);
+
+    // The child only uses its own objects and leaves with _exit(), so it never touches the test state.
+    auto sender = ::fork();
+    ASSERT_GE(sender, 0);
+    if (sender == 0) ::_exit(RunSender(source.Name, port));
+
+    auto descriptor = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    ::close(listener);
+    ASSERT_GE(descriptor, 0);
+    ::setsockopt(descriptor, SOL_SOCKET, SO_RCVTIMEO, &SocketTimeout, sizeof(SocketTimeout));
+
+    std::thread writer([&source]()
+    {
+        cv::Mat picture(240, 320, CV_8UC3);
+        for (std::uint64_t sequence = 1; sequence <= BridgedPictures; ++sequence)
+        {
+            Fill(picture, sequence);
+            while (!source.Writer.Write(picture)) std::this_thread::yield();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    PictureReader reader(destination.Name);
+    cv::Mat output;
+    std::uint64_t received = 0, torn_pictures = 0, sequence = 0;
+    try
+    {
+        BridgeReceiver receiver(destination.Writer, descriptor);
+        std::size_t published;
+        while (receiver.ReceiveBatch(published))
+        {
+            if (!reader.TryRead(sequence, output, sequence)) continue;
+            ++received;
+            if (output.rows != 240 || output.cols != 320 || !IsUniform(output, output.data[0])) ++torn_pictures;
+        }
+    }catch(std::exception& error)
+    {
+        ADD_FAILURE() << error.what();
+    }
+    ::close(descriptor);
+    writer.join();
+
+    int status = 0;
+    ASSERT_EQ(::waitpid(sender, &status, 0), sender);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    EXPECT_GT(received, 0u);
+    EXPECT_EQ(torn_pictures, 0u);
+    // The last picture is always sent, so it is the newest picture of the destination block.
+    EXPECT_TRUE(IsUniform(reader.ReadCopy(), BridgedPictures));
+}
\ No newline at end of file
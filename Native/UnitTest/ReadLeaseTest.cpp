@@ -0,0 +1,83 @@
+#include "RingBlock.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+using namespace Gaia::SharedPicture;
+using namespace Gaia::SharedPicture::UnitTest;
+
+namespace
+{
+    /// Count of leases taken while the writer thread races.
+    constexpr std::uint64_t RacingLeases = 2000;
+}
+
+TEST(ReadLeaseTest, LeasedSlotIsSkippedByWriter)
+{
+    RingBlock block("gaia_unit_test_lease_skip", 3, 64 * 64);
+    PictureReader reader(block.Name);
+    cv::Mat picture(64, 64, CV_8UC1);
+
+    EXPECT_FALSE(reader.Lease());
+
+    Fill(picture, 1);
+    ASSERT_TRUE(block.Writer.Write(picture));
+    auto lease = reader.Lease();
+    ASSERT_TRUE(lease);
+    EXPECT_EQ(lease.GetSequence(), 1u);
+
+    for (std::uint64_t sequence = 2; sequence < 10; ++sequence)
+    {
+        Fill(picture, sequence);
+        ASSERT_TRUE(block.Writer.Write(picture));
+        EXPECT_TRUE(IsUniform(lease.GetPicture(), 1));
+    }
+
+    auto moved = std::move(lease);
+    EXPECT_FALSE(lease);
+    ASSERT_TRUE(moved);
+    EXPECT_TRUE(IsUniform(moved.GetPicture(), 1));
+    moved.Release();
+    EXPECT_FALSE(moved);
+}
+
+TEST(ReadLeaseTest, LeasedPictureStaysIntactWhileWriterRaces)
+{
+    RingBlock block("gaia_unit_test_lease_race", 4, 320 * 240 * 3);
+    std::atomic<bool> stopped {false};
+
+    std::thread writer([&block, &stopped]()
+    {
+        cv::Mat picture(240, 320, CV_8UC3);
+        for (std::uint64_t sequence = 1; !stopped.load(std::memory_order_acquire); ++sequence)
+        {
+            Fill(picture, sequence);
+            while (!block.Writer.Write(picture) && !stopped.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    PictureReader reader(block.Name);
+    std::uint64_t leases = 0, last_sequence = 0, torn_leases = 0, overwritten_leases = 0, backward_leases = 0;
+    while (leases < RacingLeases)
+    {
+        auto lease = reader.Lease();
+        if (!lease) continue;
+        ++leases;
+        if (lease.GetSequence() < last_sequence) ++backward_leases;
+        last_sequence = lease.GetSequence();
+        if (!IsUniform(lease.GetPicture(), last_sequence)) ++torn_leases;
+        // Give the writer time to lap the ring, the leased slot must not be reused meanwhile.
+        std::this_thread::yield();
+        if (!IsUniform(lease.GetPicture(), last_sequence)) ++overwritten_leases;
+    }
+    stopped.store(true, std::memory_order_release);
+    writer.join();
+
+    EXPECT_EQ(torn_leases, 0u);
+    EXPECT_EQ(overwritten_leases, 0u);
+    EXPECT_EQ(backward_leases, 0u);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <GaiaSharedPicture/GaiaSharedPicture.hpp>
+#include <cstdint>
+#include <string>
+
+namespace Gaia::SharedPicture::UnitTest
+{
+    /// Ring layout block which is removed when the test finishes.
+    class RingBlock
+    {
+    public:
+        const std::string Name;
+        PictureWriter Writer;
+
+        RingBlock(const std::string& name, unsigned int slot_count, unsigned int max_picture_size) :
+            Name(name), Writer(Prepare(name), max_picture_size, true, MakeOptions(slot_count))
+        {}
+
+        ~RingBlock()
+        {
+            Remove(Name);
+        }
+
+    private:
+        /// Remove a block left over by a crashed run, and pass the name on.
+        static const std::string& Prepare(const std::string& name)
+        {
+            Remove(name);
+            return name;
+        }
+
+        static void Remove(const std::string& name)
+        {
+            boost::interprocess::shared_memory_object::remove(name.c_str());
+        }
+
+        static BlockOptions MakeOptions(unsigned int slot_count)
+        {
+            BlockOptions options;
+            options.Layout = BlockOptions::Layouts::Ring;
+            options.SlotCount = slot_count;
+            return options;
+        }
+    };
+
+    /// Fill the picture with the low byte of the sequence, so a torn copy shows up as mixed values.
+    inline void Fill(cv::Mat& picture, std::uint64_t sequence)
+    {
+        picture.setTo(cv::Scalar(static_cast<double>(sequence & 0xFF)));
+    }
+
+    /// Check whether every byte of the picture carries the low byte of the sequence.
+    inline bool IsUniform(const cv::Mat& picture, std::uint64_t sequence)
+    {
+        const auto expected = static_cast<unsigned char>(sequence & 0xFF);
+        // Rows of pictures aliasing a slot may be padded, so only the bytes of each row are checked.
+        const auto row_size = static_cast<std::size_t>(picture.cols) * picture.elemSize();
+        for (int row = 0; row < picture.rows; ++row)
+        {
+            const auto* bytes = picture.ptr<unsigned char>(row);
+            for (std::size_t index = 0; index < row_size; ++index)
+            {
+                if (bytes[index] != expected) return false;
+            }
+        }
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "RingBlock.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+using namespace Gaia::SharedPicture;
+using namespace Gaia::SharedPicture::UnitTest;
+
+namespace
+{
+    /// Count of pictures written by the racing writer thread.
+    constexpr std::uint64_t RacingPictures = 20000;
+}
+
+TEST(SequenceLockTest, TryReadSkipsUnchangedPictures)
+{
+    RingBlock block("gaia_unit_test_sequence_try_read", 2, 64 * 64);
+    PictureReader reader(block.Name);
+    cv::Mat picture(64, 64, CV_8UC1), output;
+    std::uint64_t sequence = 0;
+
+    EXPECT_FALSE(reader.TryRead(0, output, sequence));
+
+    Fill(picture, 1);
+    ASSERT_TRUE(block.Writer.Write(picture));
+    ASSERT_TRUE(reader.TryRead(0, output, sequence));
+    EXPECT_EQ(sequence, 1u);
+    EXPECT_TRUE(IsUniform(output, 1));
+    EXPECT_FALSE(reader.TryRead(sequence, output, sequence));
+
+    ASSERT_TRUE(reader.ReadIfNewer(output));
+    EXPECT_EQ(reader.GetLastSequence(), 1u);
+    EXPECT_FALSE(reader.ReadIfNewer(output));
+}
+
+TEST(SequenceLockTest, TryReadNeverTearsWhileWriterRaces)
+{
+    RingBlock block("gaia_unit_test_sequence_race", 2, 320 * 240 * 3);
+    std::atomic<bool> finished {false};
+
+    std::thread writer([&block, &finished]()
+    {
+        cv::Mat picture(240, 320, CV_8UC3);
+        for (std::uint64_t sequence = 1; sequence <= RacingPictures; ++sequence)
+        {
+            Fill(picture, sequence);
+            while (!block.Writer.Write(picture)) std::this_thread::yield();
+        }
+        finished.store(true, std::memory_order_release);
+    });
+
+    PictureReader reader(block.Name);
+    cv::Mat output;
+    std::uint64_t last_sequence = 0, sequence = 0, reads = 0, torn_reads = 0, backward_reads = 0;
+    while (!finished.load(std::memory_order_acquire) || last_sequence < RacingPictures)
+    {
+        if (!reader.TryRead(last_sequence, output, sequence)) continue;
+        ++reads;
+        if (sequence <= last_sequence) ++backward_reads;
+        if (!IsUniform(output, sequence)) ++torn_reads;
+        last_sequence = sequence;
+    }
+    writer.join();
+
+    EXPECT_GT(reads, 0u);
+    EXPECT_EQ(torn_reads, 0u);
+    EXPECT_EQ(backward_reads, 0u);
+    EXPECT_EQ(last_sequence, RacingPictures);
+}
\ No newline at end of file